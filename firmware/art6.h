@@ -198,12 +198,14 @@
 //   1     x	HIGH
 //   0     1    MID
 //   0     0    LOW
-#define GET_DR_STATE(x) (\
-    !keypad_get_switch(g_model.expoData[x].drSw1) ?   \
+#define GET_DR_STATE_EX(x, GET_SWITCH) (\
+    !GET_SWITCH(g_model.expoData[x].drSw1) ?          \
 		DR_HIGH :                                     \
-		!keypad_get_switch(g_model.expoData[x].drSw2)?\
+		!GET_SWITCH(g_model.expoData[x].drSw2)?       \
 				DR_MID : 							  \
-				DR_LOW);
+				DR_LOW)
+
+#define GET_DR_STATE(x) GET_DR_STATE_EX(x, keypad_get_switch)
 
 //#define DR_BOTH   2
 //#define DR_DRSW1  99
@@ -273,10 +275,13 @@
 
 #define PROTO_PPM        0
 #define PROTO_PPM16	   	 1
-#define PROTO_PPMSIM     2		// Always make this the last protocol
-#define PROT_MAX         2
+#define PROTO_SBUS       2
+#define PROTO_CRSF       3
+#define PROTO_MULTI      4
+#define PROTO_PPMSIM     5		// Always make this the last protocol
+#define PROT_MAX         5
 
-#define PROT_STR "\006PPM   PPM16 PPMSIM"
+#define PROT_STR "\006PPM   PPM16 SBUS  CRSF  MULTI PPMSIM"
 //
 //#define TRIM_EXTENDED_MAX	500
 //
@@ -501,14 +506,16 @@ extern volatile uint8_t LcdLock ;
 //bool eeModelExists(uint8_t id);
 //
 #define NUM_PPM     8
-//number of real output channels CH1-CH8
-#define NUM_CHNOUT  8
+//number of real output channels CH1-CH16
+#define NUM_CHNOUT  16
+//channels in one PPM stream (PPM16: CH1-CH8 on PPM-OUT, CH9-CH16 on the trainer port)
+#define NUM_PPM_CHNOUT 8
 ///number of real input channels (1-9) plus virtual input channels X1-X4
 #define PPM_BASE    MIX_CYC3 // 12
 #define CHOUT_BASE  (PPM_BASE+NUM_PPM) // 20
 //
 //
-#define NUM_XCHNRAW (CHOUT_BASE+NUM_CHNOUT) // NUMCH + P1P2P3+ AIL/RUD/ELE/THR + MAX/FULL + CYC1/CYC2/CYC3 ==28
+#define NUM_XCHNRAW (CHOUT_BASE+NUM_CHNOUT) // NUMCH + P1P2P3+ AIL/RUD/ELE/THR + MAX/FULL + CYC1/CYC2/CYC3 ==36
 ////#define NUM_XCHNRAW (CHOUT_BASE+NUM_CHNOUT+1) // NUMCH + P1P2P3+ AIL/RUD/ELE/THR + MAX/FULL + CYC1/CYC2/CYC3 +3POS
 /////number of real output channels (CH1-CH8) plus virtual output channels X1-X4
 #define NUM_XCHNOUT (NUM_CHNOUT) //(NUM_CHNOUT)//+NUM_VIRT)
@@ -656,7 +663,7 @@ extern volatile uint8_t LcdLock ;
 //extern union p2mhz_t pulses2MHz ;
 extern volatile int16_t            g_ppmIns[8];
 extern volatile uint8_t ppmInValid;
-extern volatile int16_t            g_chans[NUM_CHNOUT];
+extern volatile int16_t * volatile g_chans;
 //extern volatile uint8_t   tick10ms;
 //
 //extern int16_t BandGap ; // VccV ;
@@ -820,6 +827,20 @@ struct t_latency
 	// TODO: unused ? uint16_t g_timeMain ;
 } ;
 
+// Channel frame hand over between the mixer and the pulse generator
+struct t_frame_stats
+{
+	uint32_t published ;	// complete frames written by the mixer
+	uint32_t consumed ;		// frames picked up by the pulse generator
+	uint32_t dropped ;		// frames overwritten before being sent
+	uint32_t repeated ;		// pulse frames built from an already sent frame
+	uint32_t failsafe ;		// frames sent with failsafe channel values
+	uint16_t latency_min ;	// stick sample to frame start (us)
+	uint16_t latency_max ;
+	uint32_t latency_total ;
+	uint32_t latency_frames ;
+} ;
+
 #ifndef TRUE
 #define TRUE 1
 #endif
@@ -0,0 +1,167 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * CRSF (Crossfire) frames are: address, length, type, payload, CRC.
+ * The length counts type, payload and CRC, the CRC8 (DVB-S2, poly 0xD5)
+ * covers type and payload.
+ *
+ * RC_CHANNELS_PACKED carries 16 channels of 11 bits, packed as SBUS.
+ * The module answers on the same wire (half-duplex), its frames are fed
+ * in a byte at a time and LINK_STATISTICS ends up in g_crsfLink.
+ *
+ */
+
+#include "crsf.h"
+#include "sbus.h"
+
+volatile struct t_crsf_link g_crsfLink;
+
+// Packet periods (us), 50, 150, 250 and 500Hz
+const uint16_t crsf_periods[CRSF_RATES] = { 20000, 6667, 4000, 2000 };
+
+static uint8_t rx_buf[CRSF_FRAME_MAX];
+static uint8_t rx_len;
+
+static const uint8_t crc8_dvb_s2[256] = {
+		0x00, 0xD5, 0x7F, 0xAA, 0xFE, 0x2B, 0x81, 0x54,
+		0x29, 0xFC, 0x56, 0x83, 0xD7, 0x02, 0xA8, 0x7D,
+		0x52, 0x87, 0x2D, 0xF8, 0xAC, 0x79, 0xD3, 0x06,
+		0x7B, 0xAE, 0x04, 0xD1, 0x85, 0x50, 0xFA, 0x2F,
+		0xA4, 0x71, 0xDB, 0x0E, 0x5A, 0x8F, 0x25, 0xF0,
+		0x8D, 0x58, 0xF2, 0x27, 0x73, 0xA6, 0x0C, 0xD9,
+		0xF6, 0x23, 0x89, 0x5C, 0x08, 0xDD, 0x77, 0xA2,
+		0xDF, 0x0A, 0xA0, 0x75, 0x21, 0xF4, 0x5E, 0x8B,
+		0x9D, 0x48, 0xE2, 0x37, 0x63, 0xB6, 0x1C, 0xC9,
+		0xB4, 0x61, 0xCB, 0x1E, 0x4A, 0x9F, 0x35, 0xE0,
+		0xCF, 0x1A, 0xB0, 0x65, 0x31, 0xE4, 0x4E, 0x9B,
+		0xE6, 0x33, 0x99, 0x4C, 0x18, 0xCD, 0x67, 0xB2,
+		0x39, 0xEC, 0x46, 0x93, 0xC7, 0x12, 0xB8, 0x6D,
+		0x10, 0xC5, 0x6F, 0xBA, 0xEE, 0x3B, 0x91, 0x44,
+		0x6B, 0xBE, 0x14, 0xC1, 0x95, 0x40, 0xEA, 0x3F,
+		0x42, 0x97, 0x3D, 0xE8, 0xBC, 0x69, 0xC3, 0x16,
+		0xEF, 0x3A, 0x90, 0x45, 0x11, 0xC4, 0x6E, 0xBB,
+		0xC6, 0x13, 0xB9, 0x6C, 0x38, 0xED, 0x47, 0x92,
+		0xBD, 0x68, 0xC2, 0x17, 0x43, 0x96, 0x3C, 0xE9,
+		0x94, 0x41, 0xEB, 0x3E, 0x6A, 0xBF, 0x15, 0xC0,
+		0x4B, 0x9E, 0x34, 0xE1, 0xB5, 0x60, 0xCA, 0x1F,
+		0x62, 0xB7, 0x1D, 0xC8, 0x9C, 0x49, 0xE3, 0x36,
+		0x19, 0xCC, 0x66, 0xB3, 0xE7, 0x32, 0x98, 0x4D,
+		0x30, 0xE5, 0x4F, 0x9A, 0xCE, 0x1B, 0xB1, 0x64,
+		0x72, 0xA7, 0x0D, 0xD8, 0x8C, 0x59, 0xF3, 0x26,
+		0x5B, 0x8E, 0x24, 0xF1, 0xA5, 0x70, 0xDA, 0x0F,
+		0x20, 0xF5, 0x5F, 0x8A, 0xDE, 0x0B, 0xA1, 0x74,
+		0x09, 0xDC, 0x76, 0xA3, 0xF7, 0x22, 0x88, 0x5D,
+		0xD6, 0x03, 0xA9, 0x7C, 0x28, 0xFD, 0x57, 0x82,
+		0xFF, 0x2A, 0x80, 0x55, 0x01, 0xD4, 0x7E, 0xAB,
+		0x84, 0x51, 0xFB, 0x2E, 0x7A, 0xAF, 0x05, 0xD0,
+		0xAD, 0x78, 0xD2, 0x07, 0x53, 0x86, 0x2C, 0xF9
+};
+
+/**
+  * @brief  CRC8 DVB-S2 of a buffer.
+  * @note
+  * @param  ptr: The data.
+  * @param  len: Its length.
+  * @retval CRC.
+  */
+uint8_t crsf_crc8(const uint8_t *ptr, uint8_t len)
+{
+	uint8_t crc = 0;
+
+	while (len--)
+		crc = crc8_dvb_s2[crc ^ *ptr++];
+	return crc;
+}
+
+/**
+  * @brief  Build an RC_CHANNELS_PACKED frame.
+  * @note
+  * @param  frame: Where the CRSF_FRAME_LEN bytes go.
+  * @param  values: 16 values, 0 - 2047 (992 = 1500us).
+  * @retval None.
+  */
+void crsf_pack(uint8_t *frame, const uint16_t *values)
+{
+	frame[0] = CRSF_ADDRESS_MODULE;
+	frame[1] = CRSF_FRAME_LEN - 2;
+	frame[2] = CRSF_FRAMETYPE_RC_CHANNELS_PACKED;
+	sbus_pack_channels(&frame[3], values);
+	frame[CRSF_FRAME_LEN - 1] = crsf_crc8(&frame[2], CRSF_FRAME_LEN - 3);
+}
+
+/**
+  * @brief  Forget any partly received frame.
+  * @note	Called as each radio frame goes out, so a reply cut short
+  * 		cannot swallow the next one.
+  * @param  None.
+  * @retval None.
+  */
+void crsf_rx_reset(void)
+{
+	rx_len = 0;
+}
+
+/**
+  * @brief  Take a byte from the module.
+  * @note	Called from the USART interrupt. Frames not addressed to the
+  * 		radio are skipped a byte at a time until one is.
+  * @param  data: The byte.
+  * @retval None.
+  */
+void crsf_rx_byte(uint8_t data)
+{
+	const uint8_t *p;
+
+	if (rx_len == 0 && data != CRSF_ADDRESS_RADIO)
+		return;
+
+	rx_buf[rx_len++] = data;
+
+	if (rx_len == 2 && (data < 2 || data > CRSF_FRAME_MAX - 2))
+	{
+		rx_len = 0;
+		return;
+	}
+
+	if (rx_len < 2 || rx_len < rx_buf[1] + 2)
+		return;
+
+	// Complete frame
+	rx_len = 0;
+	if (crsf_crc8(&rx_buf[2], rx_buf[1] - 1) != rx_buf[rx_buf[1] + 1])
+	{
+		g_crsfLink.errors++;
+		return;
+	}
+
+	if (rx_buf[2] == CRSF_FRAMETYPE_LINK_STATISTICS
+			&& rx_buf[1] == CRSF_LINK_STATS_LEN + 2)
+	{
+		p = &rx_buf[3];
+		g_crsfLink.uplinkRssi1 = p[0];
+		g_crsfLink.uplinkRssi2 = p[1];
+		g_crsfLink.uplinkLq = p[2];
+		g_crsfLink.uplinkSnr = (int8_t)p[3];
+		g_crsfLink.antenna = p[4];
+		g_crsfLink.rfMode = p[5];
+		g_crsfLink.txPower = p[6];
+		g_crsfLink.downlinkRssi = p[7];
+		g_crsfLink.downlinkLq = p[8];
+		g_crsfLink.downlinkSnr = (int8_t)p[9];
+		g_crsfLink.frames++;
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+#ifndef _CRSF_H
+#define _CRSF_H
+
+ /*
+  * CRSF frame packing and link statistics parsing.
+  */
+
+#include <stdint.h>
+
+#define CRSF_BAUDRATE		400000	// 8N1, half-duplex
+#define CRSF_ADDRESS_MODULE	0xEE	// Radio to module frames
+#define CRSF_ADDRESS_RADIO	0xEA	// Module to radio frames
+#define CRSF_FRAMETYPE_LINK_STATISTICS	0x14
+#define CRSF_FRAMETYPE_RC_CHANNELS_PACKED	0x16
+#define CRSF_FRAME_LEN		26		// RC_CHANNELS_PACKED, address to CRC
+#define CRSF_FRAME_MAX		64		// Longest frame, address to CRC
+#define CRSF_LINK_STATS_LEN	10		// Link statistics payload
+
+#define CRSF_RATES			4		// Packet rates, see crsf_rates[]
+
+// Module link statistics, from its LINK_STATISTICS frames.
+struct t_crsf_link
+{
+	uint8_t uplinkRssi1 ;	// -dBm, antenna 1
+	uint8_t uplinkRssi2 ;	// -dBm, antenna 2
+	uint8_t uplinkLq ;		// %
+	int8_t uplinkSnr ;		// dB
+	uint8_t antenna ;
+	uint8_t rfMode ;
+	uint8_t txPower ;
+	uint8_t downlinkRssi ;	// -dBm
+	uint8_t downlinkLq ;	// %
+	int8_t downlinkSnr ;	// dB
+	uint16_t frames ;		// link statistics received
+	uint16_t errors ;		// frames with a bad CRC
+} ;
+
+extern volatile struct t_crsf_link g_crsfLink;
+extern const uint16_t crsf_periods[CRSF_RATES];
+
+uint8_t crsf_crc8(const uint8_t *ptr, uint8_t len);
+void crsf_pack(uint8_t *frame, const uint16_t *values);
+void crsf_rx_byte(uint8_t data);
+void crsf_rx_reset(void);
+
+#endif // _CRSF_H
@@ -24,6 +24,7 @@
 
 //#define PUTS
 #include "debug.h"
+#include "perf.h"
 
 // forwards
 void eeprom_wait_complete(void);
@@ -320,6 +321,7 @@ void I2C1_ER_IRQHandler(void) {
  * @retval None
  */
 void I2C1_EV_IRQHandler(void) {
+	uint32_t perf = perf_start();
 	uint32_t event = I2C_GetLastEvent(I2C1);
 #define ISEV(EV) ((event & EV)==EV)
 
@@ -414,6 +416,8 @@ void I2C1_EV_IRQHandler(void) {
 		dputs("CP");
 		break;
 	}
+
+	perf_record(PERF_I2C1_EV, perf);
 }
 
 /**
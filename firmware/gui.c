@@ -32,6 +32,8 @@
 #include "icons.h"
 #include "sound.h"
 #include "strings.h"
+#include "crsf.h"
+#include "multi.h"
 
 // Battery values.
 #define BATT_MIN	99	//NiMh: 88
@@ -62,7 +64,7 @@
 
 #define LIST_ROWS	7
 
-#define PAGE_LIMIT	((g_current_layout == GUI_LAYOUT_SYSTEM_MENU)?5:9)
+#define PAGE_LIMIT	((g_current_layout == GUI_LAYOUT_SYSTEM_MENU)?6:10)
 #define COL_IGNORE 255
 
 static volatile GUI_LAYOUT g_new_layout = GUI_LAYOUT_NONE;
@@ -852,7 +854,7 @@ void gui_process(uint32_t data) {
 			/**********************************************************************
 			 * System Menu
 			 *
-			 * This is the main system menu with 6 pages.
+			 * This is the main system menu with 7 pages.
 			 *
 			 */
 
@@ -862,7 +864,7 @@ void gui_process(uint32_t data) {
 			lcd_write_int(context.page + 1,
 					(context.menu_mode == MENU_MODE_PAGE) ?
 							LCD_OP_CLR : LCD_OP_SET, FLAGS_NONE);
-			lcd_write_string("/6",
+			lcd_write_string("/7",
 					(context.menu_mode == MENU_MODE_PAGE) ?
 							LCD_OP_CLR : LCD_OP_SET, FLAGS_NONE);
 
@@ -1372,6 +1374,42 @@ void gui_process(uint32_t data) {
 				break; // SYS_PAGE_ANA
 			}
 
+			case SYS_PAGE_FILTER: {
+				context.item_limit = NUM_STICK_FILTERS;
+				context.col_limit = 3 - 1;
+				// First row isn't editable
+				if (context.item == 0)
+					context.item = 1;
+				FOREACH_ROW
+				{
+					if (row == 0) {
+						lcd_set_cursor(42, context.cur_row_y);
+						lcd_write_string("dead hyst iir", LCD_OP_SET,
+								FLAGS_NONE);
+						continue;
+					}
+
+					volatile StickFilter* const f =
+							&g_eeGeneral.stickFilter[row - 1];
+					char s[3] = "A0";
+					s[1] += row - 1;
+					lcd_write_string(s, context.op_list, FLAGS_NONE);
+
+					FOREACH_COL
+					{
+						switch (col) {
+						GUI_CASE_OFS(0, 62,
+								GUI_EDIT_INT_EX2(f->deadband, 0, 100, 0, ALIGN_RIGHT, {}))
+						GUI_CASE_OFS(1, 86,
+								GUI_EDIT_INT_EX2(f->hysteresis, 0, 31, 0, ALIGN_RIGHT, {}))
+						GUI_CASE_OFS(2, 104,
+								GUI_EDIT_INT_EX2(f->iir, 0, 7, 0, ALIGN_RIGHT, {}))
+						}
+					}
+				}
+				break; // SYS_PAGE_FILTER
+			}
+
 			case SYS_PAGE_CAL:
 				lcd_set_cursor(5, 16);
 				lcd_draw_message(msg[GUI_MSG_CAL_OK_START], LCD_OP_SET, 0, 0);
@@ -1393,7 +1431,7 @@ void gui_process(uint32_t data) {
 			/**********************************************************************
 			 * Model Menu
 			 *
-			 * This is the model editing menu with 10 pages.
+			 * This is the model editing menu with 11 pages.
 			 *
 			 */
 
@@ -1406,7 +1444,7 @@ void gui_process(uint32_t data) {
 					(context.menu_mode == MENU_MODE_PAGE) ?
 							LCD_OP_CLR : LCD_OP_SET, ALIGN_RIGHT);
 			lcd_set_cursor(110, 0);
-			lcd_write_string("/10",
+			lcd_write_string("/11",
 					(context.menu_mode == MENU_MODE_PAGE) ?
 							LCD_OP_CLR : LCD_OP_SET, FLAGS_NONE);
 
@@ -1481,14 +1519,56 @@ void gui_process(uint32_t data) {
 					GUI_CASE_OFS(6, 96,
 							GUI_EDIT_ENUM( g_model.thrExpo, 0, 1, menu_on_off ))
 					GUI_CASE_OFS(7, 96, GUI_EDIT_INT( g_model.trimInc, 0, 7 ))
-					GUI_CASE_OFS(8, 96,
-							GUI_EDIT_ENUM( g_model.extendedLimits, 0, 1, menu_on_off ))
+					GUI_CASE_OFS(8, 96, {
+							bool serial = pulses_is_serial(g_model.protocol);
+							GUI_EDIT_ENUM( g_model.protocol, 0, PROT_MAX - 1, protocols )
+							// SBUS, CRSF and Multi take the console's USART.
+							if (!serial && pulses_is_serial(g_model.protocol))
+								gui_popup(GUI_MSG_SERIAL_CONSOLE, 0);
+							}
+						);
 					GUI_CASE_OFS(9, 96,
-							GUI_EDIT_INT( g_model.ppmNCH, 1, NUM_CHNOUT ))
-					GUI_CASE_OFS(10, 96, GUI_EDIT_INT( g_model.ppmDelay, 0, 7 ))
-					GUI_CASE_OFS(11, 96,
+							GUI_EDIT_ENUM( g_model.extendedLimits, 0, 1, menu_on_off ))
+					GUI_CASE_OFS(10, 96,
+							GUI_EDIT_INT( g_model.ppmNCH, 1, NUM_PPM_CHNOUT ))
+					GUI_CASE_OFS(11, 96, GUI_EDIT_INT( g_model.ppmDelay, 0, 7 ))
+					GUI_CASE_OFS(12, 96,
 							GUI_EDIT_INT( g_model.ppmFrameLength, 0, 7 ))
-					GUI_CASE_OFS(12, 96, {
+					GUI_CASE_OFS(13, 96,
+							GUI_EDIT_ENUM( g_model.ppmAdaptive, 0, 1, menu_on_off ))
+					GUI_CASE_OFS(14, 96,
+							GUI_EDIT_ENUM( g_model.sbusFast, 0, 1, menu_on_off ))
+					GUI_CASE_OFS(15, 96,
+							GUI_EDIT_ENUM( g_model.crsfRate, 0, CRSF_RATES - 1, crsf_rates ))
+					GUI_CASE_OFS(16, 84, {
+							// worst case / all centred, not editable
+							lcd_write_int(pulses_get_frame_rate(TRUE), LCD_OP_SET, FLAGS_NONE);
+							lcd_write_char('/', LCD_OP_SET, FLAGS_NONE);
+							lcd_write_int(pulses_get_frame_rate(FALSE), LCD_OP_SET, FLAGS_NONE);
+							}
+						);
+					GUI_CASE_OFS(17, 84, {
+							// CRSF module uplink, not editable
+							lcd_write_int(g_crsfLink.uplinkLq, LCD_OP_SET, FLAGS_NONE);
+							lcd_write_char('/', LCD_OP_SET, FLAGS_NONE);
+							lcd_write_int(-g_crsfLink.uplinkRssi1, LCD_OP_SET, FLAGS_NONE);
+							}
+						);
+					GUI_CASE_OFS(18, 96,
+							GUI_EDIT_INT( g_model.multiProtocol, 0, MULTI_PROTOCOLS - 1 ))
+					GUI_CASE_OFS(19, 96,
+							GUI_EDIT_INT( g_model.sub_protocol, 0, MULTI_TYPES - 1 ))
+					GUI_CASE_OFS(20, 96,
+							GUI_EDIT_INT( g_model.multiRxNum, 0, MULTI_RX_NUMS - 1 ))
+					GUI_CASE_OFS(21, 96,
+							GUI_EDIT_INT( g_model.multiOption, -128, 127 ))
+					GUI_CASE_OFS(22, 96,
+							GUI_EDIT_ENUM( g_model.multiLowPower, 0, 1, menu_on_off ))
+					GUI_CASE_OFS(23, 96,
+							GUI_EDIT_ENUM( g_model.multiAutoBind, 0, 1, menu_on_off ))
+					GUI_CASE_OFS(24, 96,
+							GUI_EDIT_ENUM( g_multiBind, 0, 1, menu_on_off ))
+					GUI_CASE_OFS(25, 96, {
 							g_model.beepANACenter = gui_bitfield_edit(
 								&context, "123456",
 								g_model.beepANACenter, context.inc,
@@ -1581,9 +1661,8 @@ void gui_process(uint32_t data) {
 							|| (mx->destCh
 									&& g_model.mixData[row - 1].destCh
 											!= mx->destCh)) {
-						char s[4] = "CH0";
-						s[2] += mx->destCh;
-						lcd_write_string(s, context.op_list, FLAGS_NONE);
+						lcd_write_string(mix_src[CHOUT_BASE + mx->destCh],
+								context.op_list, FLAGS_NONE);
 					} else {
 						lcd_write_string(mix_mode[mx->destCh ? mx->mltpx : 0],
 								context.op_list, FLAGS_NONE);
@@ -1662,9 +1741,8 @@ void gui_process(uint32_t data) {
 				context.col_limit = 4 - 1;
 				FOREACH_ROW
 				{
-					char s[4] = "CH1";
-					s[2] += row;
-					lcd_write_string(s, context.op_list, CHAR_NOSPACE);
+					lcd_write_string(mix_src[CHOUT_BASE + 1 + row],
+							context.op_list, CHAR_NOSPACE);
 
 					volatile LimitData* const p = &g_model.limitData[row];
 
@@ -1685,6 +1763,28 @@ void gui_process(uint32_t data) {
 				}
 				break;
 
+			case MOD_PAGE_FAILSAFE:
+				context.item_limit = NUM_CHNOUT - 1;
+				context.col_limit = 2 - 1;
+				FOREACH_ROW
+				{
+					lcd_write_string(mix_src[CHOUT_BASE + 1 + row],
+							context.op_list, CHAR_NOSPACE);
+
+					volatile FailsafeData* const p = &g_model.failsafe[row];
+
+					FOREACH_COL
+					{
+						switch (col) {
+						GUI_CASE_OFS(0, 6 * 6,
+								GUI_EDIT_ENUM(p->mode, FAILSAFE_HOLD, FAILSAFE_NOPULSE, failsafe_modes))
+						GUI_CASE_OFS(1, 19 * 6 + 2,
+								GUI_EDIT_INT_EX2(p->value, -100, 100, 0, ALIGN_RIGHT, {}))
+						}
+					}
+				}
+				break;
+
 			case MOD_PAGE_CURVES:
 				context.item_limit = MAX_CURVE5 + MAX_CURVE9 - 1;
 				context.submenu_page = MOD_PAGE_CURVE_EDIT;
@@ -1708,9 +1808,8 @@ void gui_process(uint32_t data) {
 				context.col_limit = 3 - 1;
 				FOREACH_ROW
 				{
-					char s[4] = "CH0";
-					s[2] = '1' + row;
-					lcd_write_string(s, context.op_list, TRAILING_SPACE);
+					lcd_write_string(mix_src[CHOUT_BASE + 1 + row],
+							context.op_list, TRAILING_SPACE);
 					FOREACH_COL
 					{
 						SafetySwData* d = &g_model.safetySw[row];
@@ -1736,10 +1835,9 @@ void gui_process(uint32_t data) {
 				MixData* const mx = &g_model.mixData[sub_edit_item];
 				// print label for this mix on header row (top)
 				{
-					char s[4] = "CH0";
-					s[2] += mx->destCh;
 					lcd_set_cursor(9 * 6, 0);
-					lcd_write_string(s, LCD_OP_CLR, FLAGS_NONE);
+					lcd_write_string(mix_src[CHOUT_BASE + mx->destCh],
+							LCD_OP_CLR, FLAGS_NONE);
 				}
 
 				context.item_limit = MIXER_EDIT_LIST1_LEN - 1;
@@ -1812,6 +1910,17 @@ void gui_process(uint32_t data) {
 				break;
 			}
 			} // switch (context.page)
+
+			// Any key in the model menu may have changed the mix setup.
+			if (g_update_type & UPDATE_KEYPRESS)
+			{
+				uint16_t cycle = mixer_get_cycle_channels();
+
+				mixer_recompile();
+				// Warn when an edit closes a new loop between channels.
+				if (mixer_get_cycle_channels() & ~cycle)
+					gui_popup(GUI_MSG_MIX_CYCLE, 0);
+			}
 		} // else // GUI_LAYOUT_MODEL_MENU
 
 		break;
@@ -2051,6 +2160,7 @@ static void gui_show_switches(void) {
 static void gui_show_battery(int x, int y) {
 	int batt;
 	int level;
+	uint16_t mins;
 
 	batt = sticks_get_battery();
 	level = 12 * (batt - BATT_MIN) / (BATT_MAX - BATT_MIN);
@@ -2068,6 +2178,16 @@ static void gui_show_battery(int x, int y) {
 	lcd_set_cursor(x + 15, y);
 	lcd_write_int(batt, LCD_OP_SET, INT_DIV10);
 	lcd_write_string("v", LCD_OP_SET, FLAGS_NONE);
+
+	// Time left to the warning level
+	lcd_draw_rect(x + 15, y + 8, LCD_WIDTH - 1, y + 15, LCD_OP_CLR, RECT_FILL);
+	lcd_set_cursor(x + 15, y + 8);
+	mins = sticks_get_battery_minutes();
+	if (mins == BATT_MINUTES_UNKNOWN)
+		lcd_write_string("--", LCD_OP_SET, FLAGS_NONE);
+	else
+		lcd_write_int((mins > 999) ? 999 : mins, LCD_OP_SET, FLAGS_NONE);
+	lcd_write_string("m", LCD_OP_SET, FLAGS_NONE);
 }
 
 /**
@@ -30,6 +30,7 @@
 #include "myeeprom.h"
 #include "lcd.h"
 #include "sound.h"
+#include "perf.h"
 
 #define ROW_MASK       (0x07 << 12)
 #define COL_MASK       (0x0F << 8)
@@ -46,6 +47,10 @@ static uint32_t keys_pressed = 0;
 static uint32_t key_repeat = 0;
 static uint32_t key_time = 0;
 
+// Debounced switch state, updated once per mixer run.
+static uint8_t switch_state = 0;
+static uint8_t switch_raw = 0;
+
 
 static void keypad_process(uint32_t data);
 
@@ -115,6 +120,10 @@ void keypad_init(void) {
 	NVIC_Init(&nvicInit);
 
 	task_register(TASK_PROCESS_KEYPAD, keypad_process);
+
+	// Start from the current switch positions, without edges.
+	switch_raw = keypad_get_switches();
+	switch_state = switch_raw;
 }
 
 /**
@@ -138,25 +147,43 @@ uint8_t keypad_get_pressed(KEYPAD_KEY key) {
  * @retval uint8_t: Bitmask of the switches
  */
 uint8_t keypad_get_switches(void) {
+	uint16_t portb = GPIOB->IDR;
 	uint8_t switches = 0;
-	if (!GPIO_ReadInputDataBit(GPIOB, GPIO_Pin_0))
+
+	if (!(portb & GPIO_Pin_0))
 		switches |= SWITCH_SWA;
 
-	if (!GPIO_ReadInputDataBit(GPIOB, GPIO_Pin_1))
+	if (!(portb & GPIO_Pin_1))
 		switches |= SWITCH_SWB;
 
-	if (!GPIO_ReadInputDataBit(GPIOB, GPIO_Pin_5))
+	if (!(portb & GPIO_Pin_5))
 		switches |= SWITCH_SWC;
 
-	if (!GPIO_ReadInputDataBit(GPIOC, GPIO_Pin_13))
+	if (!(GPIOC->IDR & GPIO_Pin_13))
 		switches |= SWITCH_SWD;
 
 	return switches;
 }
 
+/**
+ * @brief  Take the switch snapshot used by keypad_get_switch_snapshot().
+ * @note   Called once at the start of each mixer run so the whole frame
+ *         sees the same switch positions. A switch has to read the same
+ *         on two consecutive runs before its state changes.
+ * @param  None
+ * @retval None
+ */
+void keypad_snapshot_switches(void) {
+	uint8_t raw = keypad_get_switches();
+	uint8_t stable = ~(raw ^ switch_raw);
+
+	switch_state = (switch_state & ~stable) | (raw & stable);
+	switch_raw = raw;
+}
+
 /**
  * @brief  Check a specific switch
- * @note  sw==0 always on!
+ * @note  sw==0 always on! Reads the switches now.
  * @param  sw: The Switch to check. sw==0 always on
  * @retval bool: true if on, false if off.
  */
@@ -164,6 +191,17 @@ uint8_t keypad_get_switch(KEYPAD_SWITCH sw) {
 	return sw == 0 || (keypad_get_switches() & sw);
 }
 
+/**
+ * @brief  Check a specific switch in the mixer's snapshot
+ * @note  sw==0 always on! Reads the last keypad_snapshot_switches(),
+ *        for the mixer only.
+ * @param  sw: The Switch to check. sw==0 always on
+ * @retval bool: true if on, false if off.
+ */
+uint8_t keypad_get_switch_snapshot(KEYPAD_SWITCH sw) {
+	return sw == 0 || (switch_state & sw);
+}
+
 /**
  * @brief  Check if any switches are up.
  * @note   Blocks transmitter startup if switches aren't safe
@@ -419,6 +457,7 @@ KEYPAD_KEY keypad_scan_keys(void) {
  * @retval None
  */
 void EXTI15_10_IRQHandler(void) {
+	uint32_t perf = perf_start();
 	uint32_t flags = EXTI->PR;
 
 	if ((flags & KEYPAD_EXTI_LINES) != 0) {
@@ -450,4 +489,6 @@ void EXTI15_10_IRQHandler(void) {
 				task_schedule(TASK_PROCESS_KEYPAD, 1, 0);
 		}
 	}
+
+	perf_record(PERF_EXTI15_10, perf);
 }
@@ -58,6 +58,8 @@ KEYPAD_KEY keypad_scan_keys(void);
 uint8_t keypad_get_pressed(KEYPAD_KEY key);
 uint8_t keypad_get_switches(void);
 uint8_t keypad_get_switch(KEYPAD_SWITCH sw);
+uint8_t keypad_get_switch_snapshot(KEYPAD_SWITCH sw);
+void keypad_snapshot_switches(void);
 void check_switches(void);
 void keypad_cancel_repeat(void);
 
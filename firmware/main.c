@@ -35,6 +35,7 @@
 #include "logo.h"
 #include "debug.h"
 #include "eeprom.h"
+#include "perf.h"
 
 
 // for now / TBD
@@ -102,6 +103,36 @@ static void remote_process(uint32_t data)
 	case 'l' :
 		settings_load_current_model();
 		break;
+	// f - mixer to pulses frame counters and latency
+	case 'f' :
+		puts_dec(g_frameStats.published);
+		usart_putc(' ');
+		puts_dec(g_frameStats.consumed);
+		usart_putc(' ');
+		puts_dec(g_frameStats.dropped);
+		usart_putc(' ');
+		puts_dec(g_frameStats.repeated);
+		usart_putc(' ');
+		puts_dec(g_frameStats.failsafe);
+		// stick sample to frame start latency min avg max, sync guard (us)
+		usart_putc(' ');
+		puts_dec(g_frameStats.latency_min);
+		usart_putc(' ');
+		puts_dec(g_frameStats.latency_frames ?
+				g_frameStats.latency_total / g_frameStats.latency_frames : 0);
+		usart_putc(' ');
+		puts_dec(g_frameStats.latency_max);
+		usart_putc(' ');
+		puts_dec(sticks_get_sync_guard());
+		break;
+	// h - dump and reset the stick to PPM edge latency histograms
+	case 'h' :
+		perf_trace_dump();
+		break;
+	// p - dump and reset the ISR / task cycle counts
+	case 'p' :
+		perf_dump();
+		break;
 	case 'w' :
 		usart_puts("todo write");
 		break;
@@ -109,7 +140,7 @@ static void remote_process(uint32_t data)
 		usart_puts("todo read");
 		break;
 	case '?' :
-		usart_puts("? r<adr>,<len> w<adr>,<len> ");
+		usart_puts("? r<adr>,<len> w<adr>,<len> f h p ");
 		break;
 	default:
 		usart_putc('?');
@@ -169,6 +200,9 @@ int main(void)
 	// Initialize all things system/board related
 	system_init();
 
+	// Start the cycle counter for ISR / task profiling
+	perf_init();
+
 	// inistalize uart port
 	usart_init();
 
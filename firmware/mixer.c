@@ -21,13 +21,23 @@
  * This is where the magic happens.
  * The er9x based mixer logic is contained in here.
  *
+ * Only the core header is used here (for the interrupt mask around the
+ * mix plan swap), so the mixer can be built off-target. The only
+ * outside symbols it needs are:
+ *   system_ticks, g_model, g_eeGeneral, g_ppmIns, ppmInValid, stick_data,
+ *   pulses_frame_back(), pulses_frame_publish(), pulses_failsafe_changed(),
+ *   keypad_snapshot_switches(), keypad_get_switch_snapshot(),
+ *   keypad_cancel_repeat(), sound_play_tone(),
+ *   sound_play_tune(), sticks_get_battery() and perf_trace().
+ *
  */
 
+#include "stm32f10x.h"
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "system.h"
-#include "tasks.h"
 
 #include "art6.h"
 #include "myeeprom.h"
@@ -36,9 +46,10 @@
 #include "mixer.h"
 #include "sound.h"
 #include "keypad.h"
+#include "perf.h"
 
 static int16_t trim_increment;
-static void perOut(volatile int16_t *chanOut, uint8_t att);
+static uint8_t perOut(volatile int16_t *chanOut, uint8_t att);
 
 /**
   * @brief  Initialise the mixer.
@@ -50,11 +61,13 @@ void mixer_init(void)
 {
 	// Coarse trim
 	trim_increment = 10;
+
+	mixer_compile();
 }
 
 /**
   * @brief  The main mixer function
-  * @note	This is called from the DMA completion routine,
+  * @note	This is called from the PendSV mixer stage after each ADC scan,
   *         so keep stack usage and duration to a minimum!
   * @param  None.
   * @retval None.
@@ -67,7 +80,14 @@ void mixer_update(void)
 	// =================================
 	// Output Channel Data
 	// =================================
-	perOut(g_chans, 0);
+	// Fill the spare frame and only hand over a complete one.
+	volatile int16_t *frame = pulses_frame_back();
+
+	if (perOut(frame, 0))
+	{
+		perf_trace(TRACE_MIXED);
+		pulses_frame_publish(frame);
+	}
 }
 
 /**
@@ -150,13 +170,136 @@ int16_t mixer_get_trim(STICK stick)
 
 // Sticks that are scaled to +/- RESX and in the correct mode order.
 static int16_t calibratedStick[STICK_ADC_CHANNELS];
-static int16_t anas[NUM_XCHNRAW];
+static int16_t anas[NUM_XCHNRAW+1]; // last entry is the "off" source (always 0)
 static int32_t chans[NUM_CHNOUT];
 static int16_t ex_chans[NUM_CHNOUT]; // Outputs + intermidiates
 static uint8_t swOn[MAX_MIXERS] = {0};
 static int32_t act[MAX_MIXERS] = {0};
 static uint16_t sDelay[MAX_MIXERS] = {0};
 
+// Compiled mix line flags
+#define MIXOP_OFF_ACTIVE	0x01	// Line still contributes when its switch is off (MAX/FULL)
+#define MIXOP_LAST			0x02	// Last line of its channel, publish the output to anas[]
+#define MIXOP_DELAY			0x04	// Line has delay or slow values
+#define MIXOP_TRIM			0x08	// Add the stick trim of the source
+#define MIXOP_FMTRIM		0x10	// Offset is used as flight mode trim
+#define MIXOP_OFF_FULL		0x20	// Switched off value is -RESX (FULL), otherwise 0
+
+// Curve of a mix line, MixData.curve with FULL source variants split out.
+#define MIX_CURVE_NONE		0		// Symmetric (normal)
+#define MIX_CURVE_POS		1
+#define MIX_CURVE_NEG		2
+#define MIX_CURVE_ABS		3
+#define MIX_CURVE_STEP_POS	4
+#define MIX_CURVE_STEP_NEG	5
+#define MIX_CURVE_STEP_ABS	6
+#define MIX_CURVE_POS_FULL	7
+#define MIX_CURVE_NEG_FULL	8
+#define MIX_CURVE_CUSTOM	9		// + custom curve index
+
+typedef int16_t (*CurveFn)(int16_t v, uint8_t param);
+
+// A pre-decoded mix line, produced from MixData by mixer_compile().
+// Kept small, the mixer has two plans (see mix_plan).
+typedef struct
+{
+	int16_t offset;		// Input offset scaled to RESX
+	uint8_t curve;		// MIX_CURVE_xxx
+	uint8_t src;		// Index into anas[]
+	uint8_t dest;		// Index into chans[]
+	uint8_t swtch;		// Switch mask, 0 = always on
+	uint8_t mltpx;		// MLTPX_xxx
+	int8_t weight;
+	uint8_t flags;		// MIXOP_xxx
+	uint8_t warnMask;	// Mix warning bit
+	uint8_t line;		// Index of the source MixData (delay/slow state)
+	uint8_t delay;		// delayDown << 4 | delayUp
+} MixOp;
+
+typedef struct
+{
+	MixOp ops[MAX_MIXERS];
+	uint8_t count;
+} MixPlan;
+
+// Slow rates of a MixData line, act[] steps per 10ms (0 = no slow).
+// Indexed by line like act[], so they stay out of the plans.
+typedef struct
+{
+	int32_t up;
+	int32_t down;
+} MixRate;
+
+#define DEL_MULT 256
+
+// perOut() runs *mix_plan. mixer_compile() builds the other plan and
+// swaps the pointer, so an edit never leaves the mixer a half built plan.
+static MixPlan mix_plans[2];
+static MixPlan * volatile mix_plan = &mix_plans[0];
+static MixRate mix_rates[MAX_MIXERS];
+static volatile uint8_t mix_plan_valid = 0;
+static uint16_t mix_cycle_channels = 0;
+static uint16_t mix_trainer_channels = 0;
+
+// Model data behind each compiled part, to recompile only what changed.
+typedef enum
+{
+	MIX_PART_LINES,		// mixData -> mix plan
+	MIX_PART_EXPO,		// expoData -> expo tables
+	MIX_PART_CURVES,	// curves5, curves9 -> curve segments
+	MIX_PART_LIMITS,	// limitData, safetySw -> chan_limits
+	MIX_PART_PULSES,	// ppmNCH..multiOption, failsafe -> pulses failsafe table
+	MIX_PARTS
+} MixPart;
+
+static uint16_t mix_part_sums[MIX_PARTS];
+
+// Expo lookup tables, one per distinct non zero expo value in the model.
+// expo() is odd, so only 0..RESX is stored and the sign is applied after.
+#define EXPO_LUT_SHIFT		4
+#define EXPO_LUT_POINTS		((RESX >> EXPO_LUT_SHIFT) + 1)
+#define EXPO_LUT_TABLES		4		// 130 bytes each, a table per entry would take 3120
+#define EXPO_LUT_NONE		0xFF	// Use expo() directly (k == 0 or pool full)
+
+static int16_t expo_lut[EXPO_LUT_TABLES][EXPO_LUT_POINTS];
+static uint8_t expo_lut_map[STICKS_TO_TRIM][3][2]; // [stick][DR state][direction]
+
+// Custom curves as segment tables over 0..2*RESX.
+// Segments are 2^shift wide (shift >= 8) so evaluation is a mask, shift
+// and multiply-add. Values are scaled by RESX/4 (i.e. curve point * 256).
+#define CURVE_SEG_POINTS	9
+#define CURVE_SEG_HALF		0x01	// 5 point rounding, weights in half steps of the 512 segment
+
+typedef struct
+{
+	int16_t base[CURVE_SEG_POINTS];			// Value at the start of each segment
+	int16_t slope[CURVE_SEG_POINTS - 1];	// Point difference across the segment
+	uint8_t shift;							// log2 of the segment width
+	uint8_t last;							// Index of the end point
+	uint8_t flags;							// CURVE_SEG_xxx
+} CurveSeg;
+
+static CurveSeg curve_segs[MAX_CURVE5 + MAX_CURVE9];
+
+// Output limits, resolved from LimitData and SafetySwData.
+// The reverse is folded in by negating the scaling and offset and swapping
+// the clamps, so the output stage is a scale, an add and two compares.
+#define LIMIT_SAFETY		0x01	// Channel has a safety switch
+
+typedef struct
+{
+	int16_t mulPos;		// Scale for positive mixer sums (lim_p - ofs)
+	int16_t mulNeg;		// Scale for negative mixer sums (ofs - lim_n)
+	int16_t offset;		// Offset in RESX
+	int16_t min;		// Lower clamp in RESX
+	int16_t max;		// Upper clamp in RESX
+	int16_t safetyVal;	// Safety switch value in RESX
+	uint8_t safetySw;	// Safety switch mask (0 = always)
+	uint8_t flags;		// LIMIT_xxx
+} ChanLimit;
+
+static ChanLimit chan_limits[NUM_CHNOUT];
+
 // Inactivity Timer
 static uint8_t inacPrescale;
 static uint16_t inacCounter = 0;
@@ -219,6 +362,84 @@ int16_t expo(int16_t x, int16_t k)
     return neg? -y:y;
 }
 
+/**
+  * @brief  Build the expo lookup tables from g_model.expoData.
+  * @note	Tables are shared between sticks/rates/directions with the same
+  *         expo value. Linear interpolation over 16 step segments stays
+  *         within 1 LSB of expo() across -RESX..RESX.
+  * @param  None
+  * @retval None
+  */
+static void expo_compile(void)
+{
+	int8_t lut_k[EXPO_LUT_TABLES];
+	uint8_t tables = 0;
+	uint8_t stick, dr, dir, t;
+	uint16_t p;
+
+	for (stick = 0; stick < STICKS_TO_TRIM; stick++)
+	{
+		for (dr = 0; dr < 3; dr++)
+		{
+			for (dir = 0; dir < 2; dir++)
+			{
+				int8_t k = g_model.expoData[stick].expo[dr][DR_EXPO][dir];
+				uint8_t idx = EXPO_LUT_NONE;
+
+				if (k != 0)
+				{
+					for (t = 0; t < tables; t++)
+					{
+						if (lut_k[t] == k)
+						{
+							idx = t;
+							break;
+						}
+					}
+
+					if (idx == EXPO_LUT_NONE && tables < EXPO_LUT_TABLES)
+					{
+						lut_k[tables] = k;
+						for (p = 0; p < EXPO_LUT_POINTS; p++)
+							expo_lut[tables][p] = expo(p << EXPO_LUT_SHIFT, k);
+						idx = tables++;
+					}
+				}
+
+				expo_lut_map[stick][dr][dir] = idx;
+			}
+		}
+	}
+}
+
+/**
+  * @brief  Evaluate expo() through the table selected by expo_compile().
+  * @note	Falls back to expo() for untabulated values and |x| > RESX.
+  * @param  x: Input value.
+  * @param  idx: Table index from expo_lut_map[].
+  * @param  k: Expo value, only used for the fallback.
+  * @retval int16_t expo(x, k)
+  */
+static inline int16_t expo_lookup(int16_t x, uint8_t idx, int8_t k)
+{
+	uint16_t ax = abs(x);
+	uint16_t seg, frac;
+	int16_t *lut;
+	int16_t y;
+
+	if (idx == EXPO_LUT_NONE || ax > RESX)
+		return expo(x, k);
+
+	lut = expo_lut[idx];
+	seg = ax >> EXPO_LUT_SHIFT;
+	frac = ax & ((1 << EXPO_LUT_SHIFT) - 1);
+	y = lut[seg];
+	if (frac)
+		y += ((int32_t)(lut[seg + 1] - y) * frac + (1 << (EXPO_LUT_SHIFT - 1))) >> EXPO_LUT_SHIFT;
+
+	return (x < 0) ? -y : y;
+}
+
 static inline int16_t calc100toRESX(int8_t x)
 {
 	// ((int32_t)x * RESX)/100
@@ -235,35 +456,526 @@ static inline int16_t calc1000toRESX(int16_t x)  // improve calc time by Pat Mac
     //  return x + x/32 - x/128 + x/512;
 }
 
-int16_t intpol(int16_t x, uint8_t idx) // -100, -75, -50, -25, 0 ,25 ,50, 75, 100
+static int16_t curve_pos(int16_t v, uint8_t param)
+{
+    return v<0 ? 0 : v;   //x|x>0
+}
+
+static int16_t curve_pos_full(int16_t v, uint8_t param)
 {
-#define D9 (RESX * 2 / 8)
-#define D5 (RESX * 2 / 4)
-    bool    cv9 = idx >= MAX_CURVE5;
-    int8_t *crv = cv9 ? g_model.curves9[idx-MAX_CURVE5] : g_model.curves5[idx];
-    int16_t erg;
+    return v<0 ? -RESX : -RESX+2*v;
+}
+
+static int16_t curve_neg(int16_t v, uint8_t param)
+{
+    return v>0 ? 0 : v;   //x|x<0
+}
+
+static int16_t curve_neg_full(int16_t v, uint8_t param)
+{
+    return v>0 ? RESX : RESX+2*v;
+}
+
+static int16_t curve_abs(int16_t v, uint8_t param)
+{
+    return abs(v);        // x|abs(x)
+}
+
+static int16_t curve_step_pos(int16_t v, uint8_t param)
+{
+    return v>0 ? RESX : 0;      //f|f>0
+}
+
+static int16_t curve_step_neg(int16_t v, uint8_t param)
+{
+    return v<0 ? -RESX : 0;     //f|f<0
+}
+
+static int16_t curve_step_abs(int16_t v, uint8_t param)
+{
+    return v>0 ? RESX : -RESX;  //f|abs(f)
+}
+
+static int16_t curve_custom(int16_t v, uint8_t param)
+{
+    const CurveSeg *cs = &curve_segs[param];    //c1..c8
+    int16_t x = v + RESX;
+    int32_t erg;
 
-    x+=RESXu;
     if(x < 0) {
-        erg = (int16_t)crv[0] * (RESX/4);
+        erg = cs->base[0];
     } else if(x >= (RESX*2)) {
-        erg = (int16_t)crv[(cv9 ? 8 : 4)] * (RESX/4);
+        erg = cs->base[cs->last];
     } else {
-        int16_t a,dx;
-        if(cv9){
-            a   = (uint16_t)x / D9;
-            dx  =((uint16_t)x % D9) * 2;
+        uint8_t  seg = x >> cs->shift;
+        uint16_t r   = x & ((1 << cs->shift) - 1);
+        if(cs->flags & CURVE_SEG_HALF) {
+            erg = cs->base[seg] + (int32_t)cs->slope[seg]*(r>>1);
+            if(r & 1) erg -= cs->base[seg] >> 8;
         } else {
-            a   = (uint16_t)x / D5;
-            dx  = (uint16_t)x % D5;
+            erg = cs->base[seg] + (((int32_t)cs->slope[seg]*r) >> (cs->shift - 8));
         }
-        erg  = (int16_t)crv[a]*((D5-dx)/2) + (int16_t)crv[a+1]*(dx/2);
     }
-    return erg / 25; // 100*D5/RESX;
+
+    // erg / 25 (100*512/RESX), |erg| <= 25700
+    return erg < 0 ? -(((-erg)*5243) >> 17) : (erg*5243) >> 17;
+}
+
+// Built in curves by MIX_CURVE_xxx, custom curves go to curve_custom().
+static const CurveFn curve_fns[MIX_CURVE_CUSTOM] =
+{
+	NULL,
+	curve_pos,
+	curve_neg,
+	curve_abs,
+	curve_step_pos,
+	curve_step_neg,
+	curve_step_abs,
+	curve_pos_full,
+	curve_neg_full,
+};
+
+/**
+  * @brief  Build a curve segment table from equally spaced points.
+  * @note	The number of segments must be a power of two, no more than 8.
+  *         Curves with arbitrary x positions can be resampled onto such a
+  *         grid and share the same evaluation in curve_custom().
+  * @param  cs: Table to fill.
+  * @param  pts: Curve points, -100..100.
+  * @param  npts: Number of points (segments + 1).
+  * @param  flags: CURVE_SEG_xxx
+  * @retval None
+  */
+static void curve_seg_build(CurveSeg *cs, const volatile int8_t *pts, uint8_t npts, uint8_t flags)
+{
+	uint8_t i;
+	uint8_t shift = 11; // log2(2*RESX)
+
+	for (i = npts - 1; i > 1; i >>= 1)
+		shift--;
+
+	cs->shift = shift;
+	cs->last = npts - 1;
+	cs->flags = flags;
+	for (i = 0; i < npts; i++)
+	{
+		cs->base[i] = (int16_t)pts[i] * (RESX/4);
+		if (i > 0)
+			cs->slope[i - 1] = (int16_t)pts[i] - pts[i - 1];
+	}
+}
+
+/**
+  * @brief  Rebuild the segment tables for all custom curves.
+  * @note
+  * @param  None
+  * @retval None
+  */
+static void curve_compile(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < MAX_CURVE5; i++)
+		curve_seg_build(&curve_segs[i], g_model.curves5[i], 5, CURVE_SEG_HALF);
+	for (i = 0; i < MAX_CURVE9; i++)
+		curve_seg_build(&curve_segs[MAX_CURVE5 + i], g_model.curves9[i], 9, 0);
+}
+
+/**
+  * @brief  Build the output limit blocks from LimitData and SafetySwData.
+  * @note
+  * @param  None
+  * @retval None
+  */
+static void limit_compile(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < NUM_CHNOUT; i++)
+	{
+		volatile LimitData *ld = &g_model.limitData[i];
+		ChanLimit *cl = &chan_limits[i];
+		int8_t sw = g_model.safetySw[i].opt.ss.swtch;
+
+		int16_t ofs = ld->offset;
+		int16_t lim_p = 10*ld->max;
+		int16_t lim_n = 10*ld->min; //multiply by 10 to get same range as ofs (-1000..1000)
+		if (ofs > lim_p) ofs = lim_p;
+		if (ofs < lim_n) ofs = lim_n;
+
+		cl->mulPos = lim_p - ofs;
+		cl->mulNeg = ofs - lim_n;
+		cl->offset = calc1000toRESX(ofs);
+		cl->min = calc1000toRESX(lim_n);
+		cl->max = calc1000toRESX(lim_p);
+		// min above max always ends up at min (it is applied last).
+		if (cl->max < cl->min)
+			cl->max = cl->min;
+
+		if (ld->reverse)
+		{
+			int16_t tmp = cl->min;
+
+			cl->mulPos = -cl->mulPos;
+			cl->mulNeg = -cl->mulNeg;
+			cl->offset = -cl->offset;
+			cl->min = -cl->max;
+			cl->max = -tmp;
+		}
+
+		// Switches past SWD can never be on.
+		cl->flags = (sw && sw <= 8) ? LIMIT_SAFETY : 0;
+		cl->safetySw = (sw > 0 && sw <= 8) ? 1 << (sw - 1) : 0;
+		cl->safetyVal = calc100toRESX(g_model.safetySw[i].opt.ss.val);
+	}
 }
 
+/**
+  * @brief  Divide by 100000, rounding towards zero.
+  * @note	Reciprocal multiply, exact for the whole int32 range.
+  * @param  n: Dividend
+  * @retval n / 100000
+  */
+static inline int32_t div100000(int32_t n)
+{
+	if (n < 0)
+		return -(int32_t)(((uint64_t)(-(uint32_t)n) * 1407374884u) >> 47);
+	return ((uint64_t)n * 1407374884u) >> 47;
+}
 
-static void perOut(volatile int16_t *chanOut, uint8_t att)
+/**
+  * @brief  Scale a mixer sum to the output range of a channel.
+  * @note	Limits, offset and reverse are pre-resolved by limit_compile().
+  * @param  cl: Channel limits from chan_limits[].
+  * @param  q: Mixer sum, v*weight => 1024*100.
+  * @retval int16_t Output value in RESX.
+  */
+static inline int16_t limit_apply(const ChanLimit *cl, int32_t q)
+{
+	if (q)
+		q = div100000(q * ((q > 0) ? cl->mulPos : cl->mulNeg)); //div by 100000 -> output = -1024..1024
+
+	q += cl->offset;
+	if (q > cl->max)
+		q = cl->max;
+	if (q < cl->min)
+		q = cl->min;
+
+	//if safety sw available for channel check and replace val if needed
+	if ((cl->flags & LIMIT_SAFETY) && keypad_get_switch_snapshot(cl->safetySw))
+		q = cl->safetyVal;
+
+	return q;
+}
+
+/**
+  * @brief  Decode one MixData line into a mix plan entry.
+  * @note	Also sets the line's slow rates in mix_rates[].
+  * @param  op: Plan entry to fill.
+  * @param  line: Index of the line in g_model.mixData.
+  * @retval None
+  */
+static void mix_op_build(MixOp *op, uint8_t line)
+{
+	volatile MixData *md = &g_model.mixData[line];
+	MixRate *rate = &mix_rates[line];
+
+	op->line = line;
+	op->src = (md->srcRaw && md->srcRaw <= NUM_XCHNRAW) ? md->srcRaw - 1 : NUM_XCHNRAW;
+	op->dest = md->destCh - 1;
+	op->swtch = md->swtch;
+	op->mltpx = md->mltpx;
+	op->weight = md->weight;
+	op->flags = 0;
+	op->warnMask = md->mixWarn ? 1 << (md->mixWarn - 1) : 0;
+	op->offset = md->sOffset ? calc100toRESX(md->sOffset) : 0;
+
+	// Switched off lines only survive as MAX (0) or FULL (-RESX) when not replacing.
+	if (md->srcRaw == MIX_FULL)
+		op->flags |= MIXOP_OFF_FULL;
+	if ((md->srcRaw == MIX_MAX || md->srcRaw == MIX_FULL) && md->mltpx != MLTPX_REP)
+		op->flags |= MIXOP_OFF_ACTIVE;
+
+	if ((md->carryTrim == 0) && (md->srcRaw > 0) && (md->srcRaw <= 4))
+		op->flags |= MIXOP_TRIM;
+
+#ifdef FMODE_TRIM
+	if (md->enableFmTrim)
+	{
+		op->offset = 0;
+		if (md->srcRaw > 0 && md->srcRaw <= 4)
+			op->flags |= MIXOP_FMTRIM;
+	}
+#endif
+
+	op->delay = (md->delayDown << 4) | md->delayUp;
+	rate->up = 0;
+	rate->down = 0;
+	if (md->speedUp || md->speedDown || md->delayUp || md->delayDown)
+	{
+		int32_t r = (int32_t)DEL_MULT*2048*100;
+		if (md->weight) r /= abs(md->weight);
+		// Never 0 for a set speed, so 0 means no slow.
+		if (md->speedUp) rate->up = r / ((int16_t)100*md->speedUp);
+		if (md->speedDown) rate->down = r / ((int16_t)100*md->speedDown);
+		op->flags |= MIXOP_DELAY;
+	}
+
+	switch (md->curve)
+	{
+	case 1: // positive only
+		op->curve = (md->srcRaw == MIX_FULL) ? MIX_CURVE_POS_FULL : MIX_CURVE_POS;
+		break;
+	case 2: // negative only
+		op->curve = (md->srcRaw == MIX_FULL) ? MIX_CURVE_NEG_FULL : MIX_CURVE_NEG;
+		break;
+	default: // symmetric (normal), abs, steps and custom curves map 1:1
+		op->curve = (md->curve < 7) ? md->curve : MIX_CURVE_CUSTOM + md->curve - 7;
+		break;
+	}
+}
+
+/**
+  * @brief  Fletcher-16 over a block of model data.
+  * @note	Order sensitive, so moving a mix line changes the sum.
+  * @param  sum: Sum of the previous block, 0 to start.
+  * @param  data: Model data.
+  * @param  len: Length in bytes.
+  * @retval Running sum.
+  */
+static uint16_t mix_part_sum(uint16_t sum, volatile const void *data, uint16_t len)
+{
+	volatile const uint8_t *p = data;
+	uint16_t s1 = sum & 0xFF;
+	uint16_t s2 = sum >> 8;
+
+	while (len--)
+	{
+		s1 = (s1 + *p++) % 255;
+		s2 = (s2 + s1) % 255;
+	}
+	return (s2 << 8) | s1;
+}
+
+/**
+  * @brief  Sum the model data behind a compiled part.
+  * @note
+  * @param  part: MIX_PART_xxx.
+  * @retval Sum, see mix_part_sum().
+  */
+static uint16_t mix_part_calc(MixPart part)
+{
+	uint16_t sum = 0;
+
+	switch (part)
+	{
+	case MIX_PART_LINES:
+		sum = mix_part_sum(0, g_model.mixData, sizeof(g_model.mixData));
+		break;
+	case MIX_PART_EXPO:
+		sum = mix_part_sum(0, g_model.expoData, sizeof(g_model.expoData));
+		break;
+	case MIX_PART_CURVES:
+		sum = mix_part_sum(0, g_model.curves5, sizeof(g_model.curves5));
+		sum = mix_part_sum(sum, g_model.curves9, sizeof(g_model.curves9));
+		break;
+	case MIX_PART_LIMITS:
+		sum = mix_part_sum(0, g_model.limitData, sizeof(g_model.limitData));
+		sum = mix_part_sum(sum, g_model.safetySw, sizeof(g_model.safetySw));
+		break;
+	default:
+		// The protocol settings, with a few unrelated fields between them.
+		sum = mix_part_sum(0, &g_model.ppmNCH,
+				offsetof(ModelData, mixData) - offsetof(ModelData, ppmNCH));
+		sum = mix_part_sum(sum, g_model.failsafe, sizeof(g_model.failsafe));
+		break;
+	}
+	return sum;
+}
+
+/**
+  * @brief  Compile g_model.mixData into the mix plan not in use and swap it in.
+  * @note	All bitfield decoding, dead entry checks and curve selection are
+  *         resolved here so the mixer interrupt only walks the plan.
+  *         Lines are grouped by output channel, and channels are ordered so
+  *         that a channel used as a mix source is complete before any line
+  *         reading it. Within a channel the line order is kept. Channels in a
+  *         dependency cycle are reported by mixer_get_cycle_channels() and
+  *         read the previous frame's value where the cycle is broken.
+  *         The slow rates are updated in place, an old plan running one
+  *         more frame with them only steps at the new rate.
+  * @param  None
+  * @retval None
+  */
+static void mix_plan_compile(void)
+{
+	MixPlan *plan = (mix_plan == &mix_plans[0]) ? &mix_plans[1] : &mix_plans[0];
+	uint16_t deps[NUM_CHNOUT];
+	uint16_t used = 0;
+	uint16_t done = 0;
+	uint16_t cycle = 0;
+	uint16_t trainer = 0;
+	uint8_t lines;
+	uint8_t i, ch;
+	uint8_t n = 0;
+
+	// Find the active lines and which channels each output reads.
+	memset(deps, 0, sizeof(deps));
+	for (lines = 0; lines < MAX_MIXERS; lines++)
+	{
+		volatile MixData *md = &g_model.mixData[lines];
+
+		// first unused entry (channel==0) marks an end
+		if ((md->destCh == 0) || (md->destCh > NUM_CHNOUT))
+			break;
+
+		used |= 1 << (md->destCh - 1);
+		if (md->srcRaw > CHOUT_BASE && md->srcRaw <= CHOUT_BASE + NUM_CHNOUT
+				&& md->srcRaw - CHOUT_BASE != md->destCh)
+			deps[md->destCh - 1] |= 1 << (md->srcRaw - CHOUT_BASE - 1);
+		if (md->srcRaw > PPM_BASE && md->srcRaw <= PPM_BASE + NUM_PPM)
+			trainer |= 1 << (md->destCh - 1);
+	}
+
+	// Channels reading those, however deep.
+	for (i = 0; i < NUM_CHNOUT; i++)
+	{
+		for (ch = 0; ch < NUM_CHNOUT; ch++)
+		{
+			if (deps[ch] & trainer)
+				trainer |= 1 << ch;
+		}
+	}
+
+	// Emit channels in dependency order (lowest channel first when free to choose).
+	while (done != used)
+	{
+		uint8_t next = NUM_CHNOUT;
+
+		for (ch = 0; ch < NUM_CHNOUT; ch++)
+		{
+			if ((used & ~done & (1 << ch)) && !(deps[ch] & used & ~done))
+			{
+				next = ch;
+				break;
+			}
+		}
+
+		// Cycle: break it at the lowest remaining channel.
+		if (next == NUM_CHNOUT)
+		{
+			for (ch = 0; !(used & ~done & (1 << ch)); ch++)
+				;
+			next = ch;
+			cycle |= 1 << ch;
+		}
+
+		for (i = 0; i < lines; i++)
+		{
+			if (g_model.mixData[i].destCh - 1 == next)
+				mix_op_build(&plan->ops[n++], i);
+		}
+		plan->ops[n - 1].flags |= MIXOP_LAST;
+		done |= 1 << next;
+	}
+	plan->count = n;
+
+	// The mixer interrupt sees either the old plan or the new one.
+	__disable_irq();
+	mix_plan = plan;
+	__enable_irq();
+
+	mix_cycle_channels = cycle;
+	mix_trainer_channels = trainer;
+}
+
+/**
+  * @brief  Rebuild the parts of the mixer whose model data changed.
+  * @note	The expo, curve and limit tables are rebuilt in place, so the
+  * 		mixer skips frames while one of them is rebuilt. Editing other
+  * 		model data (names, trims, protocol) costs nothing here.
+  * @param  force: Rebuild every part.
+  * @retval None
+  */
+static void mix_parts_compile(uint8_t force)
+{
+	uint16_t sums[MIX_PARTS];
+	uint8_t part;
+
+	for (part = 0; part < MIX_PARTS; part++)
+		sums[part] = mix_part_calc(part);
+
+	if (force || sums[MIX_PART_LINES] != mix_part_sums[MIX_PART_LINES])
+		mix_plan_compile();
+
+	if (force || sums[MIX_PART_EXPO] != mix_part_sums[MIX_PART_EXPO]
+			|| sums[MIX_PART_CURVES] != mix_part_sums[MIX_PART_CURVES]
+			|| sums[MIX_PART_LIMITS] != mix_part_sums[MIX_PART_LIMITS])
+	{
+		// Make the mixer skip a frame rather than use half built tables.
+		mix_plan_valid = 0;
+		if (force || sums[MIX_PART_EXPO] != mix_part_sums[MIX_PART_EXPO])
+			expo_compile();
+		if (force || sums[MIX_PART_CURVES] != mix_part_sums[MIX_PART_CURVES])
+			curve_compile();
+		if (force || sums[MIX_PART_LIMITS] != mix_part_sums[MIX_PART_LIMITS])
+			limit_compile();
+	}
+
+	if (force || sums[MIX_PART_PULSES] != mix_part_sums[MIX_PART_PULSES])
+		pulses_failsafe_changed();
+
+	memcpy(mix_part_sums, sums, sizeof(sums));
+	mix_plan_valid = 1;
+}
+
+/**
+  * @brief  Compile the whole model for the mixer.
+  * @note	Must be called whenever a model is loaded or preset.
+  * @param  None
+  * @retval None
+  */
+void mixer_compile(void)
+{
+	mix_parts_compile(1);
+}
+
+/**
+  * @brief  Recompile the mixer after a GUI edit.
+  * @note	Only mix, expo, curve or limit changes cost a rebuild.
+  * @param  None
+  * @retval None
+  */
+void mixer_recompile(void)
+{
+	mix_parts_compile(0);
+}
+
+/**
+  * @brief  Channels whose mixes form a dependency cycle.
+  * @note	Valid after mixer_compile().
+  * @param  None
+  * @retval Bit mask of output channels, bit 0 = CH1.
+  */
+uint16_t mixer_get_cycle_channels(void)
+{
+	return mix_cycle_channels;
+}
+
+/**
+  * @brief  Channels fed from the trainer inputs.
+  * @note	Valid after mixer_compile(). Includes channels that mix in
+  * 		such a channel. The pulses put these in failsafe when the
+  * 		trainer signal is lost.
+  * @param  None
+  * @retval Bit mask of output channels, bit 0 = CH1.
+  */
+uint16_t mixer_get_trainer_channels(void)
+{
+	return mix_trainer_channels;
+}
+
+static uint8_t perOut(volatile int16_t *chanOut, uint8_t att)
 {
     int16_t trimA[4];
     uint8_t anaCenter = 0;
@@ -273,6 +985,13 @@ static void perOut(volatile int16_t *chanOut, uint8_t att)
     static uint32_t last10ms = 0;
     uint8_t tick10ms;
 
+    // Model or mix plan in flux, keep the last outputs.
+    if (!mix_plan_valid)
+        return 0;
+
+    // One coherent switch view for trainer, DR, mixes and safety switches.
+    keypad_snapshot_switches();
+
     if (last10ms < system_ticks && (system_ticks % 10) == 0)
     {
     	tick10ms = 1;
@@ -346,10 +1065,10 @@ static void perOut(volatile int16_t *chanOut, uint8_t att)
             { //only do this for sticks
 
                 //===========Trainer mode================
-                if (!(att&NO_TRAINER) && g_model.traineron)
+                if (!(att&NO_TRAINER) && g_model.traineron && ppmInValid)
                 {
                     TrainerMix* td = &g_eeGeneral.trainer.mix[i];
-                    if (td->mode && keypad_get_switch(td->swtch))
+                    if (td->mode && keypad_get_switch_snapshot(td->swtch))
                     {
                         uint8_t chStud = td->srcChn;
                         int16_t vStud  = (g_ppmIns[chStud]- g_eeGeneral.trainer.calib[chStud]) /* *2 */ ;
@@ -369,15 +1088,15 @@ static void perOut(volatile int16_t *chanOut, uint8_t att)
                     v = (int32_t)(v)*g_model.swashRingValue*RESX/((int32_t)(d)*100);
                 //===========Swash Ring================
 
-                uint8_t expoDrOn = GET_DR_STATE(i);
+                uint8_t expoDrOn = GET_DR_STATE_EX(i, keypad_get_switch_snapshot);
                 uint8_t stkDir = v>0 ? DR_RIGHT : DR_LEFT;
 
                 if(IS_THROTTLE(i) && g_model.thrExpo){
-                    v  = 2*expo((v+RESX)/2,g_model.expoData[i].expo[expoDrOn][DR_EXPO][DR_RIGHT]);
+                    v  = 2*expo_lookup((v+RESX)/2, expo_lut_map[i][expoDrOn][DR_RIGHT], g_model.expoData[i].expo[expoDrOn][DR_EXPO][DR_RIGHT]);
                     stkDir = DR_RIGHT;
                 }
                 else
-                    v  = expo(v,g_model.expoData[i].expo[expoDrOn][DR_EXPO][stkDir]);
+                    v  = expo_lookup(v, expo_lut_map[i][expoDrOn][stkDir], g_model.expoData[i].expo[expoDrOn][DR_EXPO][stkDir]);
 
                 int32_t x = (int32_t)v * (g_model.expoData[i].expo[expoDrOn][DR_WEIGHT][stkDir]+100)/100;
                 v = (int16_t)x;
@@ -413,7 +1132,7 @@ static void perOut(volatile int16_t *chanOut, uint8_t att)
         anas[MIX_FULL-1] = RESX;     // FULL
         for(i=0; i<STICK_INPUT_CHANNELS; i++) 		anas[i+PPM_BASE] = (g_ppmIns[i] - g_eeGeneral.trainer.calib[i])*2; //add ppm channels
         for(i=STICK_INPUT_CHANNELS; i<NUM_PPM; i++) anas[i+PPM_BASE]   = g_ppmIns[i]*2; //add ppm channels
-        for(i=0; i<NUM_CHNOUT; i++) 				anas[i+CHOUT_BASE] = chans[i]; //other mixes previous outputs
+        for(i=0; i<NUM_CHNOUT; i++) 				anas[i+CHOUT_BASE] = chans[i]/100; //other mixes previous outputs
 
         //===========Swash Ring================
         if(g_model.swashRingValue)
@@ -506,201 +1225,121 @@ static void perOut(volatile int16_t *chanOut, uint8_t att)
     TrimPtr[2] = &g_model.trim[2] ;
     TrimPtr[3] = &g_model.trim[3] ;
 
-    for(i=0; i<MAX_MIXERS; i++){
-        MixData *md = &g_model.mixData[i];
-
-        // first unused entry (channel==0) marks an end
-        if((md->destCh==0) || (md->destCh>NUM_CHNOUT)) break;
-
-        /* srcRaw
-        STK1..STK4
-        VRA, VRB
-        ??? non existent VRC/VRD
-		MIX_MAX   8
-		MIX_FULL  9
-		MIX_CYC1  10
-		MIX_CYC2  11
-		MIX_CYC3  12
-		CH1...CH8
-		*/
+    // Execute the compiled mix plan (see mixer_compile()).
+    const MixPlan *plan = mix_plan;
+    const MixOp *op = plan->ops;
+    const MixOp *end = plan->ops + plan->count;
+    for(; op < end; op++){
+        uint8_t line = op->line;
 
         //Notice 0 = NC switch means not used -> always on line
         int16_t v  = 0;
         uint8_t swTog;
 
-        //swOn[i]=false;
-        if(!keypad_get_switch(md->swtch)) { // switch on?  if no switch selected => on
-            swTog = swOn[i];
-            swOn[i] = 0;
-            //            if(md->srcRaw==MIX_MAX) act[i] = 0;// MAX back to 0 for slow up
-            //            if(md->srcRaw!=MIX_FULL) continue;// if not FULL - next loop
-            //            v = -RESX; // switch is off  => FULL=-RESX
-
-            if(md->srcRaw!=MIX_MAX && md->srcRaw!=MIX_FULL) continue;// if not MAX or FULL - next loop
-            if(md->mltpx==MLTPX_REP) continue; // if switch is off and REPLACE then off
-            v = (md->srcRaw == MIX_FULL ? -RESX : 0); // switch is off and it is either MAX=0 or FULL=-512
+        if(!keypad_get_switch_snapshot(op->swtch)) { // switch on?  if no switch selected => on
+            swTog = swOn[line];
+            swOn[line] = 0;
+
+            // Only MAX or FULL sources (and not REPLACE) survive a switched off line.
+            if(!(op->flags & MIXOP_OFF_ACTIVE)) {
+                if(op->flags & MIXOP_LAST) anas[op->dest+CHOUT_BASE] = chans[op->dest]/100;
+                continue;
+            }
+            v = (op->flags & MIXOP_OFF_FULL) ? -RESX : 0; // switch is off and it is either MAX=0 or FULL=-RESX
         }
         else {
-            swTog = !swOn[i];
-            swOn[i] = 1;
-            uint8_t k = md->srcRaw-1;
-            v = anas[k]; //Switch is on. MAX=FULL=512 or value.
-            if(k>=CHOUT_BASE && (k<i)) v = chans[k-CHOUT_BASE]; // if we've already calculated the value - take it instead // anas[i+CHOUT_BASE] = chans[i]
-            if(md->mixWarn) mixWarning |= 1<<(md->mixWarn-1); // Mix warning
+            swTog = !swOn[line];
+            swOn[line] = 1;
+            v = anas[op->src]; //Switch is on. MAX=FULL=512 or value. Channels already mixed this frame are current.
+            mixWarning |= op->warnMask; // Mix warning
 #ifdef FMODE_TRIM
-            if ( md->enableFmTrim )
-            {
-                if ( md->srcRaw <= 4 )
-                {
-                    TrimPtr[md->srcRaw-1] = &md->sOffset ;		// Use the value stored here for the trim
-                }
-            }
+            if(op->flags & MIXOP_FMTRIM)
+                TrimPtr[op->src] = &g_model.mixData[line].sOffset;		// Use the value stored here for the trim
 #endif
         }
 
         //========== INPUT OFFSET ===============
-#ifdef FMODE_TRIM
-        if ( md->enableFmTrim == 0 )
-#endif
-        {
-            if(md->sOffset) v += calc100toRESX(md->sOffset);
-        }
+        v += op->offset;
 
         //========== DELAY and PAUSE ===============
-        if (md->speedUp || md->speedDown || md->delayUp || md->delayDown)  // there are delay values
+        if (op->flags & MIXOP_DELAY)  // there are delay values
         {
-#define DEL_MULT 256
-
-            //if(init) {
-            //act[i]=(int32_t)v*DEL_MULT;
-            //swTog = false;
-            //}
-            int16_t diff = v-act[i]/DEL_MULT;
+            const MixRate *rate = &mix_rates[line];
+            int16_t diff = v-act[line]/DEL_MULT;
 
             if(swTog) {
                 //need to know which "v" will give "anas".
                 //curves(v)*weight/100 -> anas
                 // v * weight / 100 = anas => anas*100/weight = v
-                if(md->mltpx==MLTPX_REP)
+                if(op->mltpx==MLTPX_REP)
                 {
-                    act[i] = (int32_t)anas[md->destCh-1+CHOUT_BASE]*DEL_MULT;
-                    act[i] *=100;
-                    if(md->weight) act[i] /= md->weight;
+                    act[line] = (int32_t)anas[op->dest+CHOUT_BASE]*DEL_MULT;
+                    act[line] *=100;
+                    if(op->weight) act[line] /= op->weight;
                 }
-                diff = v-act[i]/DEL_MULT;
-                if(diff) sDelay[i] = (diff<0 ? md->delayUp :  md->delayDown) * 100;
+                diff = v-act[line]/DEL_MULT;
+                if(diff) sDelay[line] = (diff<0 ? (op->delay & 0x0F) : (op->delay >> 4)) * 100;
             }
 
-            if(sDelay[i]){ // perform delay
+            if(sDelay[line]){ // perform delay
                 if(tick10ms)
                 {
-                  sDelay[i]-- ;
+                  sDelay[line]-- ;
                 }
-                if (sDelay[i] != 0)
+                if (sDelay[line] != 0)
                 { // At end of delay, use new V and diff
-                  v = act[i]/DEL_MULT;   // Stay in old position until delay over
+                  v = act[line]/DEL_MULT;   // Stay in old position until delay over
                   diff = 0;
                 }
             }
 
-            if(diff && (md->speedUp || md->speedDown)){
+            if(diff && (rate->up || rate->down)){
                 //rate = steps/sec => 32*1024/100*md->speedUp/Down
-                //act[i] += diff>0 ? (32768)/((int16_t)100*md->speedUp) : -(32768)/((int16_t)100*md->speedDown);
                 //-100..100 => 32768 ->  100*83886/256 = 32768,   For MAX we divide by 2 sincde it's asymmetrical
                 if(tick10ms) {
-                    int32_t rate = (int32_t)DEL_MULT*2048*100;
-                    if(md->weight) rate /= abs(md->weight);
-
-// The next few lines could replace the long line act[i] = etc. - needs testing
-//										int16_t speed ;
-//                    if ( diff>0 )
-//										{
-//											speed = md->speedUp ;
-//										}
-//										else
-//										{
-//											rate = -rate ;
-//											speed = md->speedDown ;
-//										}
-//										act[i] = (speed) ? act[i]+(rate)/((int16_t)100*speed) : (int32_t)v*DEL_MULT ;
-
-										act[i] = (diff>0) ? ((md->speedUp>0)   ? act[i]+(rate)/((int16_t)100*md->speedUp)   :  (int32_t)v*DEL_MULT) :
-                                        ((md->speedDown>0) ? act[i]-(rate)/((int16_t)100*md->speedDown) :  (int32_t)v*DEL_MULT) ;
+                    act[line] = (diff>0) ? ((rate->up)   ? act[line]+rate->up   :  (int32_t)v*DEL_MULT) :
+                                           ((rate->down) ? act[line]-rate->down :  (int32_t)v*DEL_MULT) ;
+                }
+                {
+                    int32_t tmp = act[line]/DEL_MULT ;
+                    if(((diff>0) && (v<tmp)) || ((diff<0) && (v>tmp))) act[line]=(int32_t)v*DEL_MULT; //deal with overflow
                 }
-								{
-									int32_t tmp = act[i]/DEL_MULT ;
-                	if(((diff>0) && (v<tmp)) || ((diff<0) && (v>tmp))) act[i]=(int32_t)v*DEL_MULT; //deal with overflow
-								}
-                v = act[i]/DEL_MULT;
+                v = act[line]/DEL_MULT;
             }
             else if (diff)
             {
-              act[i]=(int32_t)v*DEL_MULT;
+              act[line]=(int32_t)v*DEL_MULT;
             }
         }
 
-
         //========== CURVES ===============
-        switch(md->curve){
-        case 0: // symmetric (normal)
-            break;
-        case 1: // positive only
-            if(md->srcRaw == MIX_FULL) //FUL
-            {
-                if( v<0 ) v=-RESX;   //x|x>0
-                else      v=-RESX+2*v;
-            }else{
-                if( v<0 ) v=0;   //x|x>0
-            }
-            break;
-        case 2: // negative only
-            if(md->srcRaw == MIX_FULL) //FUL
-            {
-                if( v>0 ) v=RESX;   //x|x<0
-                else      v=RESX+2*v;
-            }else{
-                if( v>0 ) v=0;   //x|x<0
-            }
-            break;
-        case 3:       // x|abs(x)
-            v = abs(v);
-            break;
-        case 4:       //f|f>0
-            v = v>0 ? RESX : 0;
-            break;
-        case 5:       //f|f<0
-            v = v<0 ? -RESX : 0;
-            break;
-        case 6:       //f|abs(f)
-            v = v>0 ? RESX : -RESX;
-            break;
-        default: //c1..c8
-            v = intpol(v, md->curve - 7);
-        }
+        if(op->curve >= MIX_CURVE_CUSTOM) v = curve_custom(v, op->curve - MIX_CURVE_CUSTOM);
+        else if(op->curve) v = curve_fns[op->curve](v, 0);
 
         //========== TRIM ===============
-        if((md->carryTrim==0) && (md->srcRaw>0) && (md->srcRaw<=4)) v += trimA[md->srcRaw-1];  //  0 = Trim ON  =  Default
+        if(op->flags & MIXOP_TRIM) v += trimA[op->src];  //  0 = Trim ON  =  Default
 
         //========== MULTIPLEX ===============
-        int32_t dv = (int32_t)v*md->weight;
+        int32_t dv = (int32_t)v*op->weight;
         // Save calculating address several times
-        int32_t *ptr = &chans[md->destCh-1] ;
-        switch((uint8_t)md->mltpx){
+        int32_t *ptr = &chans[op->dest] ;
+        switch(op->mltpx){
         case MLTPX_REP:
             *ptr = dv;
             break;
         case MLTPX_MUL:
-        	dv /= 100 ;
-			dv *= *ptr ;
+            dv /= 100 ;
+            dv *= *ptr ;
             dv /= RESXl;
             *ptr = dv ;
-//            chans[md->destCh-1] *= dv/100l;
-//            chans[md->destCh-1] /= RESXl;
             break;
         default:  // MLTPX_ADD
             *ptr += dv; //Mixer output add up to the line (dv + (dv>0 ? 100/2 : -100/2))/(100);
             break;
         }
+
+        // Channel complete, later lines using it as a source see this frame's value.
+        if(op->flags & MIXOP_LAST) anas[op->dest+CHOUT_BASE] = *ptr/100;
     }
 
     //========== MIXER WARNING ===============
@@ -727,32 +1366,11 @@ static void perOut(volatile int16_t *chanOut, uint8_t att)
         // interpolate value with min/max so we get smooth motion from center to stop
         // this limits based on v original values and min=-1024, max=1024  RESX=1024
 
-        int32_t q = chans[i];// + (int32_t)g_model.limitData[i].offset*100; // offset before limit
-
-        ex_chans[i] = q/100; //for getswitch back to -1024..1024
-
-        int16_t ofs = g_model.limitData[i].offset;
-        int16_t lim_p = 10*(g_model.limitData[i].max);//+100);
-        int16_t lim_n = 10*(g_model.limitData[i].min);//-100); //multiply by 10 to get same range as ofs (-1000..1000)
-        if(ofs>lim_p) ofs = lim_p;
-        if(ofs<lim_n) ofs = lim_n;
-
-        if(q) q = (q>0) ?
-                    q*((int32_t)lim_p-ofs)/100000 :
-                    -q*((int32_t)lim_n-ofs)/100000 ; //div by 100000 -> output = -1024..1024
+        ex_chans[i] = chans[i]/100; //for getswitch back to -1024..1024
 
-        q += calc1000toRESX(ofs);
-        lim_p = calc1000toRESX(lim_p);
-        lim_n = calc1000toRESX(lim_n);
-        if(q>lim_p) q = lim_p;
-        if(q<lim_n) q = lim_n;
-        if(g_model.limitData[i].reverse) q=-q;// finally do the reverse.
-
-        if(g_model.safetySw[i].opt.ss.swtch)  //if safety sw available for channel check and replace val if needed
-            if(keypad_get_switch(1<<(g_model.safetySw[i].opt.ss.swtch-1)))
-            	q = calc100toRESX(g_model.safetySw[i].opt.ss.val);
-
-        chanOut[i] = q; //copy consistent word to int-level
+        chanOut[i] = limit_apply(&chan_limits[i], chans[i]); //copy consistent word to int-level
     }
+
+    return 1;
 }
 
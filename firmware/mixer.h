@@ -25,6 +25,10 @@
 
 void mixer_init(void);
 void mixer_update(void);
+void mixer_compile(void);
+void mixer_recompile(void);
+uint16_t mixer_get_cycle_channels(void);
+uint16_t mixer_get_trainer_channels(void);
 
 void mixer_input_trim(KEYPAD_KEY key);
 int16_t mixer_get_trim(STICK stick);
@@ -0,0 +1,74 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Frames of the open Multiprotocol module serial format:
+ * header, protocol and flags, rx number and sub protocol (type), option,
+ * then 16 channels of 11 bits packed as SBUS. 26 bytes at 100k 8E2.
+ *
+ * The module numbers its radio protocols (FrSky D, Flysky, DSM...) and
+ * each has up to 8 sub protocols, see the module documentation.
+ *
+ * Failsafe frames have their own header and carry the values the
+ * receiver goes to on signal loss, for the protocols that support it.
+ *
+ */
+
+#include "multi.h"
+#include "sbus.h"
+
+/**
+  * @brief  Build a Multiprotocol module frame.
+  * @note
+  * @param  frame: Where the MULTI_FRAME_LEN bytes go.
+  * @param  values: 16 values, 0 - 2047 (MULTI_CENTER = 0%).
+  * @param  protocol: Module protocol number, 0 - 63.
+  * @param  type: Sub protocol, 0 - 7.
+  * @param  rxNum: Receiver number, 0 - 15.
+  * @param  option: Protocol option (frequency tune, power...).
+  * @param  flags: MULTI_FLAG_ bits.
+  * @retval None.
+  */
+void multi_pack(uint8_t *frame, const uint16_t *values, uint8_t protocol,
+		uint8_t type, uint8_t rxNum, int8_t option, uint16_t flags)
+{
+	frame[0] = (protocol < 32) ? MULTI_HEADER : MULTI_HEADER_HIGH;
+	frame[1] = (protocol & 0x1F) | (uint8_t)flags;
+	frame[2] = (rxNum & 0x0F) | ((type & 0x07) << 4) | (uint8_t)(flags >> 8);
+	frame[3] = (uint8_t)option;
+	sbus_pack_channels(&frame[4], values);
+}
+
+/**
+  * @brief  Build a Multiprotocol module failsafe frame.
+  * @note	Sent instead of a channel frame now and then, the module
+  * 		passes the values on to receivers that support it.
+  * @param  frame: Where the MULTI_FRAME_LEN bytes go.
+  * @param  values: 16 values, MULTI_FAILSAFE_NOPULSE, MULTI_FAILSAFE_HOLD
+  * 		or 1 - 2046.
+  * @param  protocol: Module protocol number, 0 - 63.
+  * @param  type: Sub protocol, 0 - 7.
+  * @param  rxNum: Receiver number, 0 - 15.
+  * @param  option: Protocol option (frequency tune, power...).
+  * @param  flags: MULTI_FLAG_ bits.
+  * @retval None.
+  */
+void multi_pack_failsafe(uint8_t *frame, const uint16_t *values, uint8_t protocol,
+		uint8_t type, uint8_t rxNum, int8_t option, uint16_t flags)
+{
+	multi_pack(frame, values, protocol, type, rxNum, option, flags);
+	frame[0] = (protocol < 32) ? MULTI_HEADER_FAILSAFE : MULTI_HEADER_FAILSAFE_HIGH;
+}
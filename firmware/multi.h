@@ -0,0 +1,55 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+#ifndef _MULTI_H
+#define _MULTI_H
+
+ /*
+  * Multiprotocol module serial frame packing.
+  */
+
+#include <stdint.h>
+
+#define MULTI_BAUDRATE		100000	// 8E2, inverted as SBUS
+#define MULTI_FRAME_LEN		26
+#define MULTI_PERIOD		7000	// us
+#define MULTI_PROTOCOLS		64		// Module protocol numbers 0 - 63
+#define MULTI_TYPES			8		// Sub protocols 0 - 7
+#define MULTI_RX_NUMS		16
+
+#define MULTI_CENTER		1024	// 0%, +/-100% is 204 - 1843
+
+// Header, protocol 0 - 31 / 32 - 63
+#define MULTI_HEADER		0x55
+#define MULTI_HEADER_HIGH	0x54
+#define MULTI_HEADER_FAILSAFE		0x57	// Failsafe values frames
+#define MULTI_HEADER_FAILSAFE_HIGH	0x56
+
+// Failsafe frame channel values, others are the value to go to
+#define MULTI_FAILSAFE_NOPULSE	0
+#define MULTI_FAILSAFE_HOLD		2047
+#define MULTI_FAILSAFE_FRAMES	1280	// One failsafe frame every ~9s
+
+// Flags, the protocol byte then the sub protocol byte
+#define MULTI_FLAG_BIND		0x0080
+#define MULTI_FLAG_AUTOBIND	0x0040
+#define MULTI_FLAG_RANGE	0x0020
+#define MULTI_FLAG_LOW_POWER	0x8000
+
+void multi_pack(uint8_t *frame, const uint16_t *values, uint8_t protocol,
+		uint8_t type, uint8_t rxNum, int8_t option, uint16_t flags);
+void multi_pack_failsafe(uint8_t *frame, const uint16_t *values, uint8_t protocol,
+		uint8_t type, uint8_t rxNum, int8_t option, uint16_t flags);
+
+#endif // _MULTI_H
@@ -44,6 +44,7 @@
 //#define MDVERS_r668 9
 //#define MDVERS_r803 10
 //#define MDVERS      11
+#define MDVERS		5	// ModelData layout, bump whenever it changes
 
 #define WARN_THR_BIT  0x01
 #define WARN_BEP_BIT  0x80
@@ -64,6 +65,15 @@
 
 #define MAX_MODES		4
 
+#define NUM_STICK_FILTERS	6	// Sticks and pots, not the battery
+
+PACK(typedef struct t_StickFilter {
+			uint8_t deadband;		// 0..100, +/-RESX units around the centre
+			uint8_t hysteresis:5;	// 0..31, +/-RESX units
+			uint8_t iir:3;			// 0=off, 1..7 time constant 2^n frames
+		})
+StickFilter;
+
 PACK(typedef struct _adc_cal
 		{
 			int16_t min;
@@ -142,6 +152,8 @@ PACK(typedef struct t_EEGeneral {
 //		uint8_t		stickReverse ;
 			//=== END === bit fields keep together for better packing
 
+			StickFilter stickFilter[NUM_STICK_FILTERS];
+
 			uint16_t chkSum;
 		})
 EEGeneral;
@@ -164,6 +176,17 @@ PACK(typedef struct t_LimitData {
 		})
 LimitData;
 
+// Failsafe modes, what a channel outputs while the pulses are in failsafe
+#define FAILSAFE_HOLD		0	// Last value before the failsafe
+#define FAILSAFE_FIXED		1	// The failsafe value
+#define FAILSAFE_NOPULSE	2	// No output (receiver failsafe)
+
+PACK(typedef struct t_FailsafeData {
+			int8_t value;// -100..100 %, FAILSAFE_FIXED
+			uint8_t mode;// FAILSAFE_
+		})
+FailsafeData;
+
 #define MLTPX_ADD  0
 #define MLTPX_MUL  1
 #define MLTPX_REP  2
@@ -173,7 +196,7 @@ PACK(typedef struct t_MixData {
 			int8_t weight;
 			int8_t sOffset;
 			/// keep the bitfields together for better packing
-			uint8_t destCh:4;// 1..NUM_CHNOUT
+			uint8_t destCh:5;// 1..NUM_CHNOUT
 			uint8_t swtch:4;// A,B,C,D - switch bitmask
 			uint8_t curve:4;//0=symmetrisch 1=no neg 2=no pos,...6 then MAX_CURVES==4
 			uint8_t delayUp:4;
@@ -194,7 +217,7 @@ PACK(typedef struct t_MixData {
 			uint8_t differential:1; // todo:unused
 			uint8_t modeControl:5;// todo: unused
 			uint8_t res:3;// todo: unused
-			uint8_t unused: 3;
+			uint8_t unused: 2;
 		})
 MixData;
 // total of 9 bytes
@@ -296,9 +319,9 @@ PACK(typedef struct t_ModelData {
 			uint8_t tmrDir:1;//0=>Count Down, 1=>Count Up
 			uint8_t traineron:1;// 0 disable trainer, 1 allow trainer
 			uint8_t t2throttle:1;// Start timer2 using throttle
-			uint8_t protocol:2;
+			uint8_t protocol:3;
 //    uint8_t   country:2 ;
-//    uint8_t   sub_protocol:2 ;
+			uint8_t sub_protocol:3;// Multi module sub protocol (type)
 			uint8_t thrTrim:1;// Enable Throttle Trim
 			uint8_t xnumBlades:2;// RPM scaling
 			uint8_t mixTime:1;// Scaling for slow/delay
@@ -316,6 +339,14 @@ PACK(typedef struct t_ModelData {
 			uint8_t swashCollectiveSource;
 			uint8_t swashRingValue;
 			int8_t ppmFrameLength;//0=22.5  (10msec-30msec) 1msec increments
+			uint8_t ppmAdaptive:1;// End the frame after the last channel and sync gap
+			uint8_t sbusFast:1;// 0=14ms 1=7ms SBUS frames
+			uint8_t crsfRate:2;// CRSF packets 0=50 1=150 2=250 3=500Hz
+			uint8_t multiRxNum:4;// Multi module receiver number
+			uint8_t multiProtocol:6;// Multi module protocol number
+			uint8_t multiLowPower:1;
+			uint8_t multiAutoBind:1;
+			int8_t multiOption;// Multi module protocol option
 			MixData mixData[MAX_MIXERS];
 			LimitData limitData[NUM_CHNOUT];
 			ExpoData expoData[4];
@@ -342,9 +373,10 @@ PACK(typedef struct t_ModelData {
 //	uint8_t   currentSource ;
 //	uint8_t   altSource ;
 //	uint8_t phaseNames[MAX_MODES][6] ;
-			ScaleData Scalers[NUM_SCALERS];// todo: unused
+			FailsafeData failsafe[NUM_CHNOUT];
 
 //		uint8_t   altSource ;
+			uint8_t modelVersion;	// MDVERS it was saved with
 			uint16_t chkSum;
 		})
 ModelData;
@@ -0,0 +1,275 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Lightweight profiling of interrupt handlers and tasks.
+ * Each slot keeps min / total / max core cycles since the last dump,
+ * measured with the free running DWT cycle counter.
+ *
+ * The latency tracer stamps each channel frame at the TracePoints and
+ * bins the time between them (and end to end) into histograms, in us.
+ * Frames are identified by their sequence number, so a stamp is never
+ * matched to another frame in the same buffer. Frames missing a stamp
+ * (the mixer stage was skipped) are not binned.
+ *
+ */
+
+#include "stm32f10x.h"
+#include "perf.h"
+#include "usart.h"
+#include "debug.h"
+#include "string.h"
+
+typedef struct
+{
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t count;
+} PerfData;
+
+static PerfData perf_data[PERF_END];
+
+typedef struct
+{
+	uint32_t seq;				// Channel frame sequence number
+	uint32_t stamp[TRACE_END];
+	uint8_t complete;			// Has all the stamps up to TRACE_PUBLISH
+	uint8_t pending;			// Waiting for its first edge
+} TraceFrame;
+
+// Histogram spans, one per pair of consecutive points, then end to end.
+#define TRACE_SPANS		TRACE_END
+
+static uint32_t trace_stamp[TRACE_EDGE];	// Frame being produced
+static uint8_t trace_points;				// Bit per point stamped into trace_stamp
+static TraceFrame trace_frames[2];			// Indexed by the sequence number's LSB
+static uint16_t trace_hist[TRACE_SPANS][PERF_HIST_BINS];
+
+static const char * const trace_names[TRACE_SPANS] =
+{
+	"smp-mix", "mix-pub", "pub-edg", "smp-edg"
+};
+
+// Bucket width of each span as a shift of us.
+static const uint8_t trace_shift[TRACE_SPANS] =
+{
+	7, 4, 11, 11			// 128us, 16us, 2ms, 2ms
+};
+
+// Generated from the lists that make PerfSlot, so a name per slot.
+#define PERF_NAME(id, name)	name,
+
+static const char * const perf_names[PERF_END] =
+{
+	PERF_LIST(PERF_NAME)
+	TASK_LIST(PERF_NAME)
+};
+
+/**
+  * @brief  Start the DWT cycle counter and clear the statistics.
+  * @note
+  * @param  None
+  * @retval None
+  */
+void perf_init(void)
+{
+	uint8_t i;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+
+	memset(perf_data, 0, sizeof(perf_data));
+	for (i = 0; i < PERF_END; i++)
+		perf_data[i].min = UINT32_MAX;
+
+	memset(trace_hist, 0, sizeof(trace_hist));
+}
+
+/**
+  * @brief  Record one run of a profiled slot.
+  * @note	Each slot must only be recorded from a single context.
+  * @param  slot: The handler / task that ran.
+  * @param  start: perf_start() value taken when it was entered.
+  * @retval None
+  */
+void perf_record(PerfSlot slot, uint32_t start)
+{
+	PerfData *pd = &perf_data[slot];
+	uint32_t cycles = DWT_CYCCNT - start;
+
+	if (cycles < pd->min) pd->min = cycles;
+	if (cycles > pd->max) pd->max = cycles;
+	pd->total += cycles;
+	pd->count++;
+}
+
+/**
+  * @brief  Print the statistics to the USART and reset them.
+  * @note	One line per slot: name min avg max count (core cycles).
+  * @param  None
+  * @retval None
+  */
+void perf_dump(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < PERF_END; i++)
+	{
+		PerfData pd;
+
+		// Take and reset the slot atomically so an ISR can't split it.
+		__disable_irq();
+		pd = perf_data[i];
+		memset(&perf_data[i], 0, sizeof(perf_data[i]));
+		perf_data[i].min = UINT32_MAX;
+		__enable_irq();
+
+		usart_puts("\r\n");
+		usart_puts(perf_names[i]);
+		usart_putc(' ');
+		if (pd.count == 0)
+		{
+			usart_putc('-');
+			continue;
+		}
+		puts_dec(pd.min);
+		usart_putc(' ');
+		puts_dec(pd.total / pd.count);
+		usart_putc(' ');
+		puts_dec(pd.max);
+		usart_putc(' ');
+		puts_dec(pd.count);
+	}
+}
+
+/**
+  * @brief  Stamp the frame being produced at a point before publishing.
+  * @note	TRACE_SAMPLE and TRACE_MIXED, from the sticks / mixer stage.
+  * 		TRACE_SAMPLE starts a new frame.
+  * @param  point: The point reached.
+  * @retval None
+  */
+void perf_trace(TracePoint point)
+{
+	trace_stamp[point] = DWT_CYCCNT;
+	if (point == TRACE_SAMPLE)
+		trace_points = 0;
+	trace_points |= 1 << point;
+}
+
+/**
+  * @brief  Stamp the frame being published and keep its stamps.
+  * @note	Called with interrupts disabled by the frame hand over.
+  * @param  seq: Sequence number of the frame.
+  * @retval None
+  */
+void perf_trace_publish(uint32_t seq)
+{
+	TraceFrame *tf = &trace_frames[seq & 1];
+
+	tf->seq = seq;
+	tf->stamp[TRACE_SAMPLE] = trace_stamp[TRACE_SAMPLE];
+	tf->stamp[TRACE_MIXED] = trace_stamp[TRACE_MIXED];
+	tf->stamp[TRACE_PUBLISH] = DWT_CYCCNT;
+	tf->complete = (trace_points == ((1 << TRACE_SAMPLE) | (1 << TRACE_MIXED)));
+	tf->pending = tf->complete;
+	trace_points = 0;
+}
+
+/**
+  * @brief  Stamp the first output edge of a frame and bin its latencies.
+  * @note	Called from the pulse DMA ISR as each frame is queued, only
+  * 		complete frames not yet sent are counted.
+  * @param  seq: Sequence number of the frame.
+  * @param  stamp: DWT_CYCCNT value the first edge goes out at.
+  * @retval None
+  */
+void perf_trace_edge(uint32_t seq, uint32_t stamp)
+{
+	TraceFrame *tf = &trace_frames[seq & 1];
+	uint32_t us_div = SystemCoreClock / 1000000;
+	uint8_t i;
+
+	// Overwritten by a later frame, or already sent.
+	if (tf->seq != seq || !tf->pending)
+		return;
+	tf->pending = 0;
+	tf->stamp[TRACE_EDGE] = stamp;
+
+	for (i = 0; i < TRACE_SPANS; i++)
+	{
+		uint8_t from = (i == TRACE_SPANS - 1) ? TRACE_SAMPLE : i;
+		uint8_t to = (i == TRACE_SPANS - 1) ? TRACE_EDGE : i + 1;
+		uint32_t bin = ((tf->stamp[to] - tf->stamp[from]) / us_div) >> trace_shift[i];
+
+		if (bin >= PERF_HIST_BINS)
+			bin = PERF_HIST_BINS - 1;
+		if (trace_hist[i][bin] < UINT16_MAX)
+			trace_hist[i][bin]++;
+	}
+}
+
+/**
+  * @brief  Get a stamp of a published frame.
+  * @note
+  * @param  seq: Sequence number of the frame.
+  * @param  point: The point to return.
+  * @param  stamp: Set to the DWT_CYCCNT value.
+  * @retval TRUE if the frame is still held and has all its stamps.
+  */
+uint8_t perf_trace_get(uint32_t seq, TracePoint point, uint32_t *stamp)
+{
+	TraceFrame *tf = &trace_frames[seq & 1];
+
+	if (tf->seq != seq || !tf->complete)
+		return FALSE;
+	*stamp = tf->stamp[point];
+	return TRUE;
+}
+
+/**
+  * @brief  Print the latency histograms to the USART and reset them.
+  * @note	One line per span: name bucket width (us) then the counts.
+  * @param  None
+  * @retval None
+  */
+void perf_trace_dump(void)
+{
+	uint8_t i, b;
+
+	for (i = 0; i < TRACE_SPANS; i++)
+	{
+		uint16_t hist[PERF_HIST_BINS];
+
+		__disable_irq();
+		memcpy(hist, trace_hist[i], sizeof(hist));
+		memset(trace_hist[i], 0, sizeof(trace_hist[i]));
+		__enable_irq();
+
+		usart_puts("\r\n");
+		usart_puts(trace_names[i]);
+		usart_putc(' ');
+		puts_dec(1 << trace_shift[i]);
+		usart_putc(':');
+		for (b = 0; b < PERF_HIST_BINS; b++)
+		{
+			usart_putc(' ');
+			puts_dec(hist[b]);
+		}
+	}
+}
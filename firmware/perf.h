@@ -0,0 +1,75 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+#ifndef _PERF_H
+#define _PERF_H
+
+ /*
+  * Module to profile interrupt handlers and tasks with the DWT cycle counter.
+  */
+
+#include <stdint.h>
+#include "tasks.h"
+
+// Cortex-M3 DWT cycle counter (not in this version of core_cm3.h).
+#define DWT_CTRL	(*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT	(*(volatile uint32_t *)0xE0001004)
+#define DWT_CTRL_CYCCNTENA	0x00000001
+
+// Each profiled handler and its perf_dump() name, the tasks follow.
+#define PERF_LIST(X) \
+	X(PERF_ADC_DMA,		"adc") \
+	X(PERF_MIXER,		"mixer") \
+	X(PERF_TIM2,		"tim2") \
+	X(PERF_TIM3,		"tim3") \
+	X(PERF_I2C1_EV,		"i2c1") \
+	X(PERF_EXTI15_10,	"exti") \
+	X(PERF_USART1,		"usart")
+
+#define PERF_ENUM(id, name)	id,
+
+typedef enum
+{
+	PERF_LIST(PERF_ENUM)
+	PERF_TASK,					// First task slot, one per Tasks entry
+	PERF_END = PERF_TASK + TASK_END
+} PerfSlot;
+
+// Points a channel frame passes on its way from the sticks to the pin.
+typedef enum
+{
+	TRACE_SAMPLE,				// Sticks taken for the mixer
+	TRACE_MIXED,				// Mixer output complete
+	TRACE_PUBLISH,				// Frame handed to the pulses
+	TRACE_EDGE,					// First PPM edge built from the frame
+	TRACE_END
+} TracePoint;
+
+// Buckets per latency histogram, the last one also counts overflows.
+#define PERF_HIST_BINS	16
+
+// Take the start timestamp at the top of the measured code.
+#define perf_start()	(DWT_CYCCNT)
+
+void perf_init(void);
+void perf_record(PerfSlot slot, uint32_t start);
+void perf_dump(void);
+
+void perf_trace(TracePoint point);
+void perf_trace_publish(uint32_t seq);
+void perf_trace_edge(uint32_t seq, uint32_t stamp);
+uint8_t perf_trace_get(uint32_t seq, TracePoint point, uint32_t *stamp);
+void perf_trace_dump(void);
+
+#endif // _PERF_H
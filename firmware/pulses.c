@@ -18,25 +18,73 @@
 
 /* Description:
  *
- * This is a standalone IRQ driven module that will take the values in
- * g_chans[] and send them out of the PPM-OUT pin.
+ * This is a standalone DMA driven module that will take the values in
+ * g_chans[] and send them out of the PPM-OUT pin, and in PPM16 mode the
+ * next 8 channels out of the trainer (PPM-IN) pin in parallel.
  *
- * g_ppmIns[] receives up to 8 Channels on the PPM-IN pin.
+ * A pulse table holds the duration of each level of the frame. On every
+ * TIM2 update DMA1 channel 2 loads the next duration into ARR, and the
+ * CC1 match at count 0 has channel 5 write the next level to GPIOA->BSRR
+ * from pulses_levels (the levels alternate, frames have an even count).
  *
- * ToDo: Implement a second set of 8 PPM outputs on the PPM-IN pin.
- * Currently this will just mirror the PPM-OUT pin when set to output mode.
+ * There are two pulse tables. The next frame is built into the one not
+ * being played as the mixer publishes a channel frame (PendSV context).
+ * The channel 2 completion, at the start of the final stop pulse, is the
+ * only interrupt and just points the DMA at the newest table (or the same
+ * one again), so TIM2 never stops.
+ *
+ * The trainer stream sits in the second half of the table. PA7 is
+ * TIM3_CH2, so TIM3 update has DMA1 channel 3 load its durations and the
+ * OC2 toggle makes the edges. Both streams are padded to the same frame
+ * length and started together, so they stay in step and the one channel 2
+ * interrupt re-arms both.
+ *
+ * Serial protocols (SBUS, CRSF, MULTI) keep TIM2 and channel 2 as the frame clock, with
+ * a one duration table and no levels. Their frame is packed into the table
+ * and the channel 2 interrupt sends it out of USART1 by DMA. Each frame
+ * gets its own mixer run, as for PPM. CRSF runs half-duplex, the module's
+ * replies are parsed by crsf_rx_byte(). USART1 is also the console, which
+ * is off while one of these is selected. The port is switched over by
+ * pulses_process() in task context, the output waits for it.
+ *
+ * g_ppmIns[] receives up to 8 Channels on the PPM-IN pin. Otherwise
+ * TIM3 captures the interval between falling edges and resets on each,
+ * and that update has DMA1 channel 3 copy it to a ring. The channel 2
+ * interrupt decodes the ring once per output frame, so the trainer input
+ * takes no interrupts of its own.
+ *
+ * Failsafe: a third table is built from the model failsafe settings
+ * after a frame that changed them, i.e. a protocol or failsafe settings
+ * change (reported by the mixer's compile) or a new held value next to
+ * fixed ones. The pulse ISR plays it instead while the model is being
+ * loaded, or once the mixer has missed PULSES_STALE_FRAMES frames. With
+ * every channel on hold there is no table, the last frame just repeats.
+ * While the trainer signal is lost the channels mixed from it take their
+ * failsafe values in the normal tables. A no pulse channel stops the PPM
+ * edges (the timers keep running), stops CRSF and Multi frames and sets
+ * the SBUS failsafe flag, leaving it to the receiver's own failsafe. Multi
+ * module receivers also get the failsafe values every ~9s.
  */
 
 #include "stm32f10x.h"
+#include "stm32f10x_usart.h"
 #include "tasks.h"
 
 #include "art6.h"
 #include "myeeprom.h"
 #include "pulses.h"
+#include "sticks.h"
+#include "perf.h"
+#include "usart.h"
+#include "sbus.h"
+#include "crsf.h"
+#include "multi.h"
+#include "mixer.h"
 
 
-#define PULSES_WORD_SIZE	72
-#define PULSES_BYTE_SIZE	(PULSES_WORD_SIZE * 2)
+#define PULSES_STREAM_SIZE	(2 * NUM_PPM_CHNOUT + 2)	// Channels, gap and stop
+#define PULSES_WORD_SIZE	(2 * PULSES_STREAM_SIZE)
+#define PULSES_SERIAL_SIZE	CRSF_FRAME_LEN	// Longest serial frame
 
 #define PPM_IN	(1 << 7)
 #define PPM_OUT	(1 << 11)
@@ -47,33 +95,87 @@
 #define PPM_MIN_FRAME_LEN  	22500
 #define PPM_MAX_FRAME_LEN	60000
 #define PPM_MIN_GAP_LEN		9000
+#define PPM_ADAPTIVE_GAP_LEN	4000	// Sync gap of adaptive frames, above the longest channel
+
+#define PPM_IN_RING_LEN		32		// Captured trainer intervals, two frames and more
+#define PPM_IN_SYNC_LEN		3000	// Shortest trainer sync gap
+#define PPM_IN_RANGE		(PPM_LIMIT_EXTENDED + 100)	// Accepted trainer channel deviation
+#define PPM_IN_MIN_CHANNELS	4		// Channels for a valid trainer frame
+#define PPM_IN_TIMEOUT		500000	// Time without a valid trainer frame until lost (us)
+
+#define PULSES_STALE_FRAMES	3		// Output frames without a new channel frame until failsafe
+#define PULSES_NO_PULSE		INT16_MIN	// Failsafe channel value, no output
+
+// Channel frames, the mixer fills one while g_chans points at the other.
+static int16_t chan_frames[2][NUM_CHNOUT];
+static uint32_t chan_frame_seq;			// Sequence number of the g_chans frame
+static uint32_t chan_frame_sent;		// Sequence number last consumed
 
 // Exported globals
 volatile struct t_latency g_latency = { 0xFF, 0 } ;
+volatile struct t_frame_stats g_frameStats;
+volatile uint8_t g_multiBind;			// Multi module bind request, from the GUI
 // TODO: what units are g_chans? (a relative full scale +-1024 or in us?)
 // for now they are relative and conv to us is in pulses.c
-volatile int16_t g_chans[NUM_CHNOUT]; 	// -1024 - 1024
+volatile int16_t * volatile g_chans = chan_frames[0]; 	// -1024 - 1024, latest complete frame
 
 static uint8_t SlaveMode;		// Trainer Slave
 
 // Private globals
-static union p1mhz_t
+typedef struct
 {
-    uint16_t pword[PULSES_WORD_SIZE] ;   //72
-    uint8_t pbyte[PULSES_BYTE_SIZE] ;   //144
-} pulses_1us;
+	uint16_t pword[PULSES_WORD_SIZE];	// Durations (us), the trainer stream in the second half
+	uint8_t serial[PULSES_SERIAL_SIZE];	// Serial protocol frame
+	uint8_t serialLen;					// Its length, 0 for PPM
+	uint32_t seq;						// Sequence number of the channel frame
+	uint16_t len;						// Length of the PPM sequence (us)
+	uint8_t count;						// Durations in the PPM-OUT sequence
+	uint8_t trnCount;					// Durations in the trainer sequence (PPM16)
+	uint8_t silent;						// No PPM edges or serial frame (no pulse failsafe)
+	uint8_t failsafe;					// Has failsafe channel values
+} PulseTable;
+
+static PulseTable pulse_tables[2];
+static PulseTable * volatile pulses_live;	// Being played by the DMA
+static PulseTable * volatile pulses_ready;	// Built, waiting for the frame end
+static uint8_t pulses_stale;				// Output frames since a new table (ISR)
+
+static PulseTable pulse_failsafe;			// Played when the mixer stops
+static volatile bool failsafe_ready;		// pulse_failsafe is complete
+static volatile bool failsafe_stale = TRUE;	// pulse_failsafe needs a rebuild
+static bool failsafe_hold_all;				// All channels hold, no failsafe table
+static int16_t failsafe_hold[NUM_CHNOUT];	// Last values out of failsafe
+static int16_t failsafe_chans[NUM_CHNOUT];	// Failsafe channel frame
+static int16_t failsafe_mixed[NUM_CHNOUT];	// Channel frame with the lost trainer channels in failsafe
+static uint16_t multi_failsafe_count;		// Multi frames since the last failsafe frame
+
+static uint32_t pulses_levels[2];		// BSRR words: channel level, stop level
 
 static volatile uint8_t heartbeat;
 static volatile uint8_t Current_protocol;
+static volatile bool pulses_port_pending = FALSE;	// USART1 not yet switched to Current_protocol
 
 volatile int16_t g_ppmIns[8];
-volatile uint8_t ppmInValid;
-static volatile uint8_t ppmInState = 0; //0=unsync 1..8= wait for value i-1
+volatile uint8_t ppmInValid;			// Set while the trainer signal is valid
+static uint32_t ppm_in_left;			// Time left until the trainer signal is lost (us)
+static uint8_t ppmInState = 0; //0=unsync 1..8= wait for value i-1
+
+static uint16_t ppm_in_ring[PPM_IN_RING_LEN];	// Trainer edge intervals (us), by DMA
+static uint8_t ppm_in_tail;						// Next interval to decode
+static uint16_t ppm_in_frame[NUM_PPM];			// Channel widths of the frame in progress
+static uint16_t ppm_in_hist[NUM_PPM][2];		// Previous two widths of each channel
 
-static bool trainer_out = FALSE;
+static bool trainer_out = FALSE;		// TIM3 drives the trainer stream
 
 static void pulses_setup(void);
-static void pulses_setup_ppm(uint8_t proto);
+static void pulses_process(uint32_t data);
+static void pulses_build(PulseTable *pt, uint8_t proto, volatile int16_t *chans);
+static void pulses_setup_ppm(PulseTable *pt, uint8_t proto, volatile int16_t *chans);
+static void pulses_setup_serial(PulseTable *pt, uint8_t proto, volatile int16_t *chans);
+static void pulses_multi_failsafe(PulseTable *pt);
+static volatile int16_t *pulses_failsafe_update(bool *failsafe);
+static void pulses_run(void);
+static void pulses_stop(void);
 static void pulses_set_trainer_port_ppm(void);
 static void pulses_set_trainer_port_capture(void);
 
@@ -89,11 +191,12 @@ void pulses_init(void)
 	NVIC_InitTypeDef nvicInit;
 	TIM_TimeBaseInitTypeDef timInit;
 	TIM_OCInitTypeDef timOcInit;
-	TIM_ICInitTypeDef timIcInit;
+	DMA_InitTypeDef dmaInit;
 
 	// Enable the GPIO block clocks and setup the pins.
 	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2 | RCC_APB1Periph_TIM3, ENABLE);
 	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, ENABLE);
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
 
 	// Setup the PPM-IN and PPM-OUT pins.
 	GPIO_ResetBits(GPIOA, PPM_IN | PPM_OUT);
@@ -112,41 +215,56 @@ void pulses_init(void)
 	TIM_DeInit(TIM3);
 	TIM_TimeBaseStructInit(&timInit);
 	TIM_OCStructInit(&timOcInit);
-	TIM_ICStructInit(&timIcInit);
 
 	// 1MHz time base
 	timInit.TIM_Prescaler = SystemCoreClock / 1000000 - 1; // 1us
 	TIM_TimeBaseInit(TIM2, &timInit);
 	TIM_TimeBaseInit(TIM3, &timInit);
 
-	// TIM2 (PPM Output)
+	// TIM2 (PPM Output), CC1 matches at the start of every period.
 	TIM_OC1Init(TIM2, &timOcInit);
-
-	// TIM3 (PPM Input)
-	timIcInit.TIM_Channel = TIM_Channel_2;
-	timIcInit.TIM_ICPolarity = TIM_ICPolarity_Falling;
-	timIcInit.TIM_ICSelection = TIM_ICSelection_DirectTI;
-	timIcInit.TIM_ICPrescaler = TIM_ICPSC_DIV1;
-	timIcInit.TIM_ICFilter = 0x0F;
-
-	TIM_ICInit(TIM3, &timIcInit);
-
-	TIM_SelectInputTrigger(TIM3, TIM_TS_TI1F_ED);
-	TIM_CCxCmd(TIM3, TIM_Channel_2, TIM_CCx_Enable);
-
-	// Enable Timer interrupts
-	TIM_ITConfig(TIM2, TIM_FLAG_CC1, ENABLE);
-	TIM_ITConfig(TIM3, TIM_FLAG_CC2, ENABLE);
+	TIM_SetCompare1(TIM2, 0);
+
+	// DMA1 channel 2 (TIM2_UP): durations into ARR, once per frame.
+	DMA_DeInit(DMA1_Channel2);
+	DMA_StructInit(&dmaInit);
+	dmaInit.DMA_PeripheralBaseAddr = (uint32_t) &TIM2->ARR;
+	dmaInit.DMA_MemoryBaseAddr = (uint32_t) pulse_tables[0].pword;
+	dmaInit.DMA_DIR = DMA_DIR_PeripheralDST;
+	dmaInit.DMA_BufferSize = 1;
+	dmaInit.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	dmaInit.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dmaInit.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	dmaInit.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	dmaInit.DMA_Mode = DMA_Mode_Normal;
+	dmaInit.DMA_Priority = DMA_Priority_VeryHigh;
+	dmaInit.DMA_M2M = DMA_M2M_Disable;
+	DMA_Init(DMA1_Channel2, &dmaInit);
+	DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, ENABLE);
+
+	// DMA1 channel 5 (TIM2_CH1): alternating levels into BSRR.
+	DMA_DeInit(DMA1_Channel5);
+	dmaInit.DMA_PeripheralBaseAddr = (uint32_t) &GPIOA->BSRR;
+	dmaInit.DMA_MemoryBaseAddr = (uint32_t) pulses_levels;
+	dmaInit.DMA_BufferSize = 2;
+	dmaInit.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+	dmaInit.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+	dmaInit.DMA_Mode = DMA_Mode_Circular;
+	DMA_Init(DMA1_Channel5, &dmaInit);
+
+	// TIM3 (trainer port) is set up by the trainer port mode.
+
+	// Enable Timer DMA requests
+	TIM_DMACmd(TIM2, TIM_DMA_Update | TIM_DMA_CC1, ENABLE);
 
 	// configure to the highest priority 0:0 (above stick's DMA)
     nvicInit.NVIC_IRQChannelPreemptionPriority = 0;
     nvicInit.NVIC_IRQChannelSubPriority = 0;
     nvicInit.NVIC_IRQChannelCmd = ENABLE;
-    nvicInit.NVIC_IRQChannel = TIM2_IRQn;
+    nvicInit.NVIC_IRQChannel = DMA1_Channel2_IRQn;
     NVIC_Init(&nvicInit);
 
-    nvicInit.NVIC_IRQChannel = TIM3_IRQn;
-    NVIC_Init(&nvicInit);
+	task_register(TASK_PROCESS_PULSES, pulses_process);
 
 	//ToDo: Set these properly before calling init.
 	Current_protocol = g_model.protocol + 10;		// Not the same!
@@ -156,14 +274,177 @@ void pulses_init(void)
 }
 
 /**
-  * @brief  Set the protocol and initialize the pulse data.
-  * @note	Can be called from ISR or main loop.
+  * @brief  Process the pulses module.
+  * @note	Task context. Hands USART1 to the protocol set up by pulses_setup(),
+  * 		so the port never changes under a console write of another task.
+  * @param  data: unused.
+  * @retval None.
+  */
+static void pulses_process(uint32_t data)
+{
+	uint8_t proto = Current_protocol;
+
+	switch (proto)
+	{
+	case PROTO_SBUS:
+		usart_set_serial(SBUS_BAUDRATE, USART_Parity_Even, USART_StopBits_2, 0);
+		break;
+
+	case PROTO_MULTI:
+		usart_set_serial(MULTI_BAUDRATE, USART_Parity_Even, USART_StopBits_2, 0);
+		break;
+
+	case PROTO_CRSF:
+		crsf_rx_reset();
+		usart_set_serial(CRSF_BAUDRATE, USART_Parity_No, USART_StopBits_1, crsf_rx_byte);
+		break;
+
+	default:
+		usart_set_console();
+		break;
+	}
+
+	// The protocol may have changed again meanwhile, then this task is due again.
+	__disable_irq();
+	if (Current_protocol == proto)
+		pulses_port_pending = FALSE;
+	__enable_irq();
+}
+
+/**
+  * @brief  Have the failsafe table rebuilt from the model settings.
+  * @note	Called by the mixer when the protocol or failsafe settings
+  * 		of the model changed.
+  * @param  None.
+  * @retval None.
+  */
+void pulses_failsafe_changed(void)
+{
+	failsafe_stale = TRUE;
+}
+
+/**
+  * @brief  Check if a protocol sends its frames out of USART1.
+  * @note	The console is off while such a protocol is selected.
+  * @param  proto: The radio protocol.
+  * @retval TRUE for SBUS, CRSF and MULTI.
+  */
+bool pulses_is_serial(uint8_t proto)
+{
+	return proto == PROTO_SBUS || proto == PROTO_CRSF || proto == PROTO_MULTI;
+}
+
+/**
+  * @brief  Get the channel frame the mixer should write next.
+  * @note	Never the frame g_chans points to.
+  * @param  None.
+  * @retval Channel buffer of NUM_CHNOUT entries.
+  */
+volatile int16_t *pulses_frame_back(void)
+{
+	return (g_chans == chan_frames[0]) ? chan_frames[1] : chan_frames[0];
+}
+
+/**
+  * @brief  Make a completely written channel frame the current one.
+  * @note	Called by the mixer after filling pulses_frame_back().
+  * @param  frame: The frame to publish.
+  * @retval None.
+  */
+void pulses_frame_publish(volatile int16_t *frame)
+{
+	__disable_irq();
+	g_chans = frame;
+	chan_frame_seq++;
+	perf_trace_publish(chan_frame_seq);
+	__enable_irq();
+
+	g_frameStats.published++;
+
+	// Build the pulses for it straight away.
+	pulses_setup();
+}
+
+/**
+  * @brief  Pick up the pulse table of the latest channel frame.
+  * @note	Called from the pulse ISR once per output frame. Falls back to
+  * 		the failsafe table without new frames. Updates the hand over
+  * 		counters and the stick sample to frame start latency.
+  * @param  None.
+  * @retval None.
+  */
+static void pulses_frame_consume(void)
+{
+	uint32_t seq;
+	uint32_t sample;
+	uint16_t latency;
+
+	if (pulses_ready)
+	{
+		pulses_live = pulses_ready;
+		pulses_ready = 0;
+		pulses_stale = 0;
+	}
+	else
+	{
+		if (pulses_stale < PULSES_STALE_FRAMES)
+			pulses_stale++;
+
+		// The mixer has stopped, or there is no model to mix. Without a
+		// failsafe table all channels hold, so the last table goes on.
+		if (failsafe_ready && (pulses_stale == PULSES_STALE_FRAMES || g_modelInvalid))
+			pulses_live = &pulse_failsafe;
+	}
+	seq = pulses_live->seq;
+
+	if (pulses_live->failsafe || pulses_stale == PULSES_STALE_FRAMES)
+		g_frameStats.failsafe++;
+
+	if (seq == chan_frame_sent)
+	{
+		g_frameStats.repeated++;
+	}
+	else
+	{
+		g_frameStats.dropped += seq - chan_frame_sent - 1;
+
+		// Only frames the mixer stage stamped all the way through.
+		if (perf_trace_get(seq, TRACE_SAMPLE, &sample))
+		{
+			latency = (DWT_CYCCNT - sample) / (SystemCoreClock / 1000000);
+			if (!g_frameStats.latency_min || latency < g_frameStats.latency_min)
+				g_frameStats.latency_min = latency;
+			if (latency > g_frameStats.latency_max)
+				g_frameStats.latency_max = latency;
+			g_frameStats.latency_total += latency;
+			g_frameStats.latency_frames++;
+		}
+	}
+
+	chan_frame_sent = seq;
+	g_frameStats.consumed++;
+}
+
+/**
+  * @brief  Set the protocol and build the next pulse table from g_chans.
+  * @note	Called from init and PendSV (mixer) context, never the pulse ISR.
+  * 		A protocol change stops the output until pulses_process() has
+  * 		switched USART1 over.
   * @param  None.
   * @retval None.
   */
 static void pulses_setup(void)
 {
 	uint8_t required_protocol ;
+	PulseTable *pt;
+	volatile int16_t *chans;
+	bool failsafe;
+
+	// Withdraw any unplayed table first, then the ISR cannot move
+	// pulses_live and the other table is free to build into.
+	pulses_ready = 0;
+	pt = (pulses_live == &pulse_tables[0]) ? &pulse_tables[1] : &pulse_tables[0];
+
 	required_protocol = g_model.protocol ;
 	// Sort required_protocol depending on student mode and PPMSIM allowed
 
@@ -180,8 +461,16 @@ static void pulses_setup(void)
         Current_protocol = required_protocol ;
         // switch mode here
 
-        // Pause the timer and reset the count.
-        TIM_Cmd(TIM2, DISABLE);
+        // Stop the output, the new frame restarts it.
+        __disable_irq();
+        pulses_stop();
+        failsafe_ready = FALSE;
+        failsafe_stale = TRUE;
+        __enable_irq();
+
+        // USART1 is switched over in task context.
+        pulses_port_pending = TRUE;
+        task_schedule(TASK_PROCESS_PULSES, 0, 0);
 
         switch(required_protocol)
         {
@@ -189,30 +478,32 @@ static void pulses_setup(void)
 		case PROTO_PPM:
 			// Use PPM-RX as an input
 			pulses_set_trainer_port_capture();
-
-			// 8-Ch PPM: Next frame starts in 20 mS
-			TIM_SetAutoreload(TIM2, PPM_MAX_FRAME_LEN);
-	        TIM_SetCounter(TIM2, 0);
-	        TIM_SetCompare1(TIM2, PPM_STOP_LEN);
-			TIM_Cmd(TIM2, ENABLE);
             break;
 
+		case PROTO_SBUS:
+			// Hold PPM output low, the frames go out of USART1 TX
+			GPIO_ResetBits(GPIOA, PPM_OUT);
+			pulses_set_trainer_port_capture();
+			break;
+
+		case PROTO_MULTI:
+			GPIO_ResetBits(GPIOA, PPM_OUT);
+			g_multiBind = FALSE;
+			pulses_set_trainer_port_capture();
+			break;
+
+		case PROTO_CRSF:
+			GPIO_ResetBits(GPIOA, PPM_OUT);
+			pulses_set_trainer_port_capture();
+			break;
+
         case PROTO_PPM16 :
 		case PROTO_PPMSIM :
 			if ( required_protocol == PROTO_PPMSIM )
 			{
-				pulses_setup_ppm(PROTO_PPMSIM);
 		        // Hold PPM output low
 				GPIO_ResetBits(GPIOA, PPM_OUT);
 			}
-			else
-			{
-				TIM_SetAutoreload(TIM2, PPM_MAX_FRAME_LEN);
-		        TIM_SetCounter(TIM2, 0);
-		        TIM_SetCompare1(TIM2, PPM_STOP_LEN);
-				TIM_Cmd(TIM2, ENABLE);
-				pulses_setup_ppm(PROTO_PPM16);
-			}
 
 			// Use PPM-RX as an output
 			pulses_set_trainer_port_ppm();
@@ -220,57 +511,254 @@ static void pulses_setup(void)
 		}
     } // current != required
 
-    switch(required_protocol)
+	// bail out when model is in flux (read from eeprom) to avoid miscomputation
+	// of channel#/start, the ISR plays the failsafe table meanwhile.
+	// Nothing goes out either until USART1 suits the protocol.
+	if( g_modelInvalid || required_protocol == PROTO_PPMSIM || pulses_port_pending )
+		return;
+
+	chans = pulses_failsafe_update(&failsafe);
+	pulses_build(pt, required_protocol, chans);
+	pt->failsafe = failsafe;
+	if (required_protocol == PROTO_MULTI && !pt->silent
+			&& ++multi_failsafe_count >= MULTI_FAILSAFE_FRAMES)
+	{
+		multi_failsafe_count = 0;
+		pulses_multi_failsafe(pt);
+	}
+	pulses_run();
+
+	// Then the failsafe table, only after a change and unless the ISR
+	// is playing it.
+	if (!failsafe_stale)
+		return;
+	__disable_irq();
+	if (pulses_live == &pulse_failsafe)
+	{
+		__enable_irq();
+		return;
+	}
+	failsafe_ready = FALSE;
+	__enable_irq();
+
+	failsafe_stale = FALSE;
+	if (failsafe_hold_all)
+		return;
+	pulses_build(&pulse_failsafe, required_protocol, failsafe_chans);
+	pulse_failsafe.failsafe = TRUE;
+	failsafe_ready = TRUE;
+}
+
+/**
+  * @brief  Work out the channel frame to build the pulses from.
+  * @note	Keeps the hold values and the failsafe frame up to date, and
+  * 		marks the failsafe table stale when that frame changed. Held
+  * 		values only count next to fixed or no pulse channels, with
+  * 		all channels holding there is no failsafe table.
+  * 		While the trainer signal is lost the channels mixed from it
+  * 		take their failsafe values.
+  * @param  failsafe: Set TRUE if any channel is in failsafe.
+  * @retval The channel frame.
+  */
+static volatile int16_t *pulses_failsafe_update(bool *failsafe)
+{
+	volatile int16_t *chans = g_chans;
+	uint16_t lost = ppmInValid ? 0 : mixer_get_trainer_channels();
+	bool hold_all = TRUE;
+	bool changed = FALSE;
+
+	for (uint8_t i = 0; i < NUM_CHNOUT; i++)
+	{
+		volatile FailsafeData *fs = &g_model.failsafe[i];
+		int16_t v;
+
+		if (!(lost & (1 << i)))
+			failsafe_hold[i] = chans[i];
+
+		if (fs->mode == FAILSAFE_FIXED)
+			v = fs->value * RESX / 100;
+		else if (fs->mode == FAILSAFE_NOPULSE)
+			v = PULSES_NO_PULSE;
+		else
+			v = failsafe_hold[i];
+		if (fs->mode == FAILSAFE_FIXED || fs->mode == FAILSAFE_NOPULSE)
+			hold_all = FALSE;
+
+		if (failsafe_chans[i] != v)
+		{
+			failsafe_chans[i] = v;
+			changed = TRUE;
+		}
+
+		failsafe_mixed[i] = (lost & (1 << i)) ? failsafe_chans[i] : chans[i];
+	}
+
+	if (hold_all != failsafe_hold_all || (changed && !hold_all))
+		failsafe_stale = TRUE;
+	failsafe_hold_all = hold_all;
+
+	*failsafe = (lost != 0);
+	return lost ? failsafe_mixed : chans;
+}
+
+/**
+  * @brief  Build a pulse table of the protocol.
+  * @note	The table must not be the one being played.
+  * @param  pt: The pulse table to fill.
+  * @param  proto: The radio protocol.
+  * @param  chans: The channel frame.
+  * @retval None.
+  */
+static void pulses_build(PulseTable *pt, uint8_t proto, volatile int16_t *chans)
+{
+    switch(proto)
     {
     case PROTO_PPM:
-    	pulses_setup_ppm( PROTO_PPM );		// Don't enable interrupts through here
+    case PROTO_PPM16:
+    	pulses_setup_ppm( pt, proto, chans );
+        break;
+    case PROTO_SBUS:
+    case PROTO_CRSF:
+    case PROTO_MULTI:
+    	pulses_setup_serial( pt, proto, chans );
         break;
-    case PROTO_PPM16 :
-    	pulses_setup_ppm( PROTO_PPM );		// Don't enable interrupts through here
-        // PPM16 pulses are set up automatically within the interrupts
-        break ;
     }
 }
 
 /**
-  * @brief  Configure the PPM pulse data from g_chans.
-  * @note: TODO: very high potential for data corruption due to pointer arithmetic gone wild!
-  * @param  proto: The radio protocol.
+  * @brief  Offer the built pulse table to the pulse ISR.
+  * @note	Starts TIM2 with it if the output is stopped.
+  * @param  None.
   * @retval None.
   */
-void pulses_setup_ppm( uint8_t proto )
+static void pulses_run(void)
 {
-	// bail out when model is in flux (read from eeprom) to avoid miscomputation of channel#/start and hence pointer gone wild
-	if( g_modelInvalid )
+	PulseTable *pt = (pulses_live == &pulse_tables[0]) ? &pulse_tables[1] : &pulse_tables[0];
+
+	// Nothing built for the latest frame (model in flux).
+	if (pt->count == 0 || pt->seq != chan_frame_seq)
 		return;
 
-	uint16_t position = 0; // Running total so we can avoid resetting the timer count and avoid jitter.
+	__disable_irq();
+	if (TIM2->CR1 & TIM_CR1_CEN)
+	{
+		// Picked up at the next frame end.
+		pulses_ready = pt;
+		__enable_irq();
+		return;
+	}
 
-	// Total frame length = 22500usec
-	// each pulse is 0.5..2.5ms long including a 300us stop tail
-	uint16_t *ptr = (proto == PROTO_PPM) ? &pulses_1us.pword[0] : &pulses_1us.pword[PULSES_WORD_SIZE/2] ;
+	pulses_live = pt;
+	DMA1_Channel2->CCR &= (uint16_t)~DMA_CCR1_EN;
+	DMA1_Channel2->CMAR = (uint32_t) pt->pword;
+	DMA1_Channel2->CNDTR = pt->count;
 
-	int8_t startChan = g_model.ppmStart;
-	int8_t p = g_model.ppmNCH; // Channels
+	// Start at the stop level, the first update (after 10us) loads the
+	// first duration and the CC1 match at count 0 its level.
+	if (!pt->serialLen)
+	{
+		GPIOA->BSRR = pulses_levels[1];
+		DMA1_Channel5->CCR &= (uint16_t)~DMA_CCR1_EN;
+		DMA1_Channel5->CNDTR = 2;
+		if (!pt->silent)
+			DMA1_Channel5->CCR |= DMA_CCR1_EN;
+	}
+	DMA1_Channel2->CCR |= DMA_CCR1_EN;
 
-	p += startChan;
+	TIM2->ARR = 10;
+	TIM2->CNT = 1;		// No CC1 match before the first update
+	TIM2->SR = 0;
 
-	// add start pulse to sequence
-	if (proto != PROTO_PPM)
+	if (trainer_out && pt->trnCount)
 	{
-		position += PPM_STOP_LEN;
-		*ptr++ = position;
+		// Same again for the trainer stream, the OC2 toggle starts from
+		// the forced stop level.
+		DMA1_Channel3->CCR &= (uint16_t)~DMA_CCR1_EN;
+		DMA1_Channel3->CMAR = (uint32_t) &pt->pword[PULSES_STREAM_SIZE];
+		DMA1_Channel3->CNDTR = pt->trnCount;
+		DMA1_Channel3->CCR |= DMA_CCR1_EN;
+
+		TIM_ForcedOC2Config(TIM3, g_model.pulsePol ? TIM_ForcedAction_Active : TIM_ForcedAction_InActive);
+		if (!pt->silent)
+			TIM3->CCMR1 = (TIM3->CCMR1 & (uint16_t)~TIM_CCMR1_OC2M) | (TIM_OCMode_Toggle << 8);
+		TIM3->ARR = 10;
+		TIM3->CNT = 1;
+		TIM3->SR = 0;
+
+		// TIM3 first, so its last transfer of a frame always comes
+		// before the TIM2 completion that re-arms both.
+		TIM3->CR1 |= TIM_CR1_CEN;
+	}
+	TIM2->CR1 |= TIM_CR1_CEN;
+	__enable_irq();
+}
+
+/**
+  * @brief  Stop the PPM output.
+  * @note
+  * @param  None.
+  * @retval None.
+  */
+static void pulses_stop(void)
+{
+	TIM2->CR1 &= (uint16_t)~TIM_CR1_CEN;
+	DMA1_Channel2->CCR &= (uint16_t)~DMA_CCR1_EN;
+	DMA1_Channel5->CCR &= (uint16_t)~DMA_CCR1_EN;
+
+	if (trainer_out)
+	{
+		TIM3->CR1 &= (uint16_t)~TIM_CR1_CEN;
+		DMA1_Channel3->CCR &= (uint16_t)~DMA_CCR1_EN;
+	}
+}
+
+/**
+  * @brief  Stop or restart the PPM edges.
+  * @note	Called from the pulse ISR in the final stop pulse, where both
+  * 		streams are at the stop level, when a silent table follows one
+  * 		that is not or the other way round. The timers keep running, so
+  * 		the edges come back in step.
+  * @param  silent: TRUE to hold the outputs at the stop level.
+  * @retval None.
+  */
+static void pulses_set_silent(bool silent)
+{
+	DMA1_Channel5->CCR &= (uint16_t)~DMA_CCR1_EN;
+	if (!silent)
+	{
+		DMA1_Channel5->CNDTR = 2;
+		DMA1_Channel5->CCR |= DMA_CCR1_EN;
 	}
 
+	if (trainer_out)
+	{
+		if (silent)
+			TIM_ForcedOC2Config(TIM3, g_model.pulsePol ? TIM_ForcedAction_Active : TIM_ForcedAction_InActive);
+		else
+			TIM3->CCMR1 = (TIM3->CCMR1 & (uint16_t)~TIM_CCMR1_OC2M) | (TIM_OCMode_Toggle << 8);
+	}
+}
+
+/**
+  * @brief  Write the channel pulses of one PPM stream.
+  * @note	Each channel is its pulse then a stop pulse.
+  * @param  ptr: Where the durations go.
+  * @param  chans: The channel frame.
+  * @param  start: First channel.
+  * @param  end: One past the last channel.
+  * @retval Length of the durations written (us).
+  */
+static uint16_t pulses_ppm_channels(uint16_t *ptr, volatile int16_t *chans, uint8_t start, uint8_t end)
+{
+	uint16_t position = 0;
 	int16_t PPM_range = g_model.extendedLimits ? PPM_LIMIT_EXTENDED : PPM_LIMIT_NORMAL;   // range of 0.7 - 2.3ms or 1.0 - 2.0ms
-	int8_t start = (proto == PROTO_PPM16) ? p-8 : startChan;
-	// restore sanity when model got corrupted and avoid wild pointer 'ptr'
-	if( start > NUM_CHNOUT ) start = NUM_CHNOUT;
-	if( p > NUM_CHNOUT ) p = NUM_CHNOUT;
-	for (uint8_t i = start; i < p; i++)
+
+	for (uint8_t i = start; i < end; i++)
 	{
 		// Get the channel relative value
-		int32_t v = g_chans[i];	// -1024 - 1024 (+/RESX)
+		int32_t v = chans[i];	// -1024 - 1024 (+/RESX)
+		if (v == PULSES_NO_PULSE)
+			v = 0;				// Keeps its slot, the stream is silent
 		// scale to max PPM_range (essentially convert to us)
 		v = (v * PPM_range + 1024/2) / 1024 /*RESX*/;
 		if (v > PPM_range) v = PPM_range;
@@ -283,66 +771,333 @@ void pulses_setup_ppm( uint8_t proto )
 
 		// Channel
 		position += v;
-		*ptr++ = position; // DANGER! if channels # are wrong *prt would run wild
+		*ptr++ = v;
 
 		// end-of-channel
 		position += PPM_STOP_LEN;
-		*ptr++ = position; // DANGER! if channels # are wrong *prt would run wild
+		*ptr++ = PPM_STOP_LEN;
 	}
 
-	// compute the finnal gap between PPM sequences (frames)
-	int32_t frameLength = g_model.ppmFrameLength * 1000; // Minimum Framelen = 22.5 ms
+	return position;
+}
+
+/**
+  * @brief  Get the PPM frame length up to the final stop pulse.
+  * @note	Fixed frames are padded to the model frame length, adaptive ones
+  * 		end after the minimum sync gap.
+  * @param  position: Length of the channel pulses (us).
+  * @retval Frame length without the final stop (us).
+  */
+static uint16_t pulses_ppm_body(uint16_t position)
+{
+	int32_t frameLength;
+
+	if (g_model.ppmAdaptive)
+		return position + PPM_ADAPTIVE_GAP_LEN;
+
+	frameLength = g_model.ppmFrameLength * 1000; // Minimum Framelen = 22.5 ms
 	if( frameLength < PPM_MIN_FRAME_LEN ) frameLength = PPM_MIN_FRAME_LEN;
-	int32_t gap = frameLength - position;
-	if (gap < PPM_MIN_GAP_LEN) gap = PPM_MIN_GAP_LEN;
+	// Keeps a frame and its stop within the uint16_t sticks_frame_sync() takes.
+	if( frameLength > PPM_MAX_FRAME_LEN ) frameLength = PPM_MAX_FRAME_LEN;
+	if (frameLength < position + PPM_MIN_GAP_LEN) frameLength = position + PPM_MIN_GAP_LEN;
+	return frameLength;
+}
+
+/**
+  * @brief  Get the serial protocol frame period of the model settings.
+  * @note
+  * @param  proto: PROTO_SBUS, PROTO_CRSF or PROTO_MULTI.
+  * @retval Period (us).
+  */
+static uint16_t pulses_serial_period(uint8_t proto)
+{
+	if (proto == PROTO_CRSF)
+		return crsf_periods[g_model.crsfRate];
+	if (proto == PROTO_MULTI)
+		return MULTI_PERIOD;
+	return g_model.sbusFast ? SBUS_PERIOD_FAST : SBUS_PERIOD;
+}
 
-	// end-of-frame
-	position += gap;
-	*ptr++ = position;
+/**
+  * @brief  Get the output frame rate of the model settings.
+  * @note	For the model setup page.
+  * @param  worst: TRUE for all channels at full deflection, else centred.
+  * @retval Frames per second.
+  */
+uint16_t pulses_get_frame_rate(bool worst)
+{
+	uint8_t n = g_model.ppmNCH;
+	uint16_t width = PPM_CENTER;
 
-	if (proto == PROTO_PPM)
+	if (pulses_is_serial(g_model.protocol))
+		return 1000000 / pulses_serial_period(g_model.protocol);
+
+	if (n < 1 || n > NUM_PPM_CHNOUT) n = NUM_PPM_CHNOUT;
+	if (g_model.ppmStart + n > NUM_CHNOUT) n = NUM_CHNOUT - g_model.ppmStart;
+	if (worst)
+		width += g_model.extendedLimits ? PPM_LIMIT_EXTENDED : PPM_LIMIT_NORMAL;
+
+	return 1000000 / (pulses_ppm_body(n * width) + PPM_STOP_LEN);
+}
+
+/**
+  * @brief  Build the PPM pulse table from a channel frame.
+  * @note	The table must not be the one being played. PPM16 adds the
+  * 		next NUM_PPM_CHNOUT channels as the trainer port stream, padded
+  * 		to the same frame length so both run in parallel. A no pulse
+  * 		channel in either stream makes the table silent.
+  * @param  pt: The pulse table to fill.
+  * @param  proto: The radio protocol.
+  * @param  chans: The channel frame.
+  * @retval None.
+  */
+static void pulses_setup_ppm( PulseTable *pt, uint8_t proto, volatile int16_t *chans )
+{
+	uint16_t *trn = &pt->pword[PULSES_STREAM_SIZE];
+	uint16_t position, trnPosition = 0;
+	uint8_t start, end, trnEnd;
+
+	// Total frame length = 22500usec
+	// each pulse is 0.5..2.5ms long including a 300us stop tail
+	// The table gets the duration of each level in turn.
+	start = g_model.ppmStart;
+	end = g_model.ppmNCH;
+	if (end < 1 || end > NUM_PPM_CHNOUT) end = NUM_PPM_CHNOUT;
+	end += start;
+	if (end > NUM_CHNOUT) end = NUM_CHNOUT;
+	trnEnd = end + NUM_PPM_CHNOUT;
+	if (trnEnd > NUM_CHNOUT) trnEnd = NUM_CHNOUT;
+
+	position = pulses_ppm_channels(pt->pword, chans, start, end);
+	if (proto == PROTO_PPM16)
+		trnPosition = pulses_ppm_channels(trn, chans, start + NUM_PPM_CHNOUT, trnEnd);
+
+	// compute the final gap between PPM sequences (frames), the same
+	// for both streams
+	uint16_t frameLength = pulses_ppm_body(position);
+	if (frameLength < pulses_ppm_body(trnPosition)) frameLength = pulses_ppm_body(trnPosition);
+
+	// end-of-frame, then a stop (the next frame is queued as it starts)
+	pt->count = 2 * (end - start);
+	pt->pword[pt->count++] = frameLength - position;
+	pt->pword[pt->count++] = PPM_STOP_LEN;
+
+	pt->trnCount = 0;
+	if (proto == PROTO_PPM16)
 	{
-		// Stop
-		position += PPM_STOP_LEN;
-		*ptr++ = position;
+		pt->trnCount = 2 * (trnEnd - start - NUM_PPM_CHNOUT);
+		trn[pt->trnCount++] = frameLength - trnPosition;
+		trn[pt->trnCount++] = PPM_STOP_LEN;
 	}
-    // mark the end of the sequence
-	*ptr = 0;
 
-	// for debugging
-	if( ptr >= &pulses_1us.pword[sizeof(pulses_1us.pword)/sizeof(pulses_1us.pword[0])])
-		// error, and now it's too late! this here is just so you can put a breakpoint
-		return;
+	pt->silent = FALSE;
+	for (uint8_t i = start; i < ((proto == PROTO_PPM16) ? trnEnd : end); i++)
+	{
+		if (chans[i] == PULSES_NO_PULSE)
+			pt->silent = TRUE;
+	}
+
+	pt->len = frameLength + PPM_STOP_LEN;
+	pt->serialLen = 0;
+	pt->seq = chan_frame_seq;
+
+	// Channel level first, then the stop level.
+	pulses_levels[0] = g_model.pulsePol ? (PPM_OUT << 16) : PPM_OUT;
+	pulses_levels[1] = g_model.pulsePol ? PPM_OUT : (PPM_OUT << 16);
 }
 
 /**
-  * @brief  Configure the trainer port and ISR in PPM output mode.
+  * @brief  Scale a channel value to a serial protocol value.
+  * @note	The channels scale like PPM, 5/8us per step around 1500us.
+  * @param  chan: Channel value, -1024 - 1024.
+  * @param  center: Protocol value of 1500us.
+  * @retval 0 - SBUS_MAX.
+  */
+static uint16_t pulses_serial_value(int16_t chan, uint16_t center)
+{
+	int16_t PPM_range = g_model.extendedLimits ? PPM_LIMIT_EXTENDED : PPM_LIMIT_NORMAL;
+
+	// -1024 - 1024 to +/- PPM_range us, 8 steps per 5us
+	int32_t v = (int32_t)chan * PPM_range * 8 / (5 * 1024) + center;
+	if (v < 0) v = 0;
+	if (v > SBUS_MAX) v = SBUS_MAX;
+	return v;
+}
+
+/**
+  * @brief  Get the Multi module frame flags of the model settings.
   * @note
   * @param  None.
+  * @retval MULTI_FLAG_ bits.
+  */
+static uint16_t pulses_multi_flags(void)
+{
+	return (g_multiBind ? MULTI_FLAG_BIND : 0)
+			| (g_model.multiAutoBind ? MULTI_FLAG_AUTOBIND : 0)
+			| (g_model.multiLowPower ? MULTI_FLAG_LOW_POWER : 0);
+}
+
+/**
+  * @brief  Build the SBUS, CRSF or Multi module frame from a channel frame.
+  * @note	The same scaling for all, Multi centres on 1024 not 992. The
+  * 		table times the frame period. A no pulse channel sets the SBUS
+  * 		failsafe flag, CRSF and Multi tables go silent.
+  * @param  pt: The pulse table to fill.
+  * @param  proto: The radio protocol.
+  * @param  chans: The channel frame.
+  * @retval None.
+  */
+static void pulses_setup_serial( PulseTable *pt, uint8_t proto, volatile int16_t *chans )
+{
+	uint16_t values[SBUS_CHANNELS];
+	uint16_t center = (proto == PROTO_MULTI) ? MULTI_CENTER : SBUS_CENTER;
+	bool noPulse = FALSE;
+
+	for (uint8_t i = 0; i < SBUS_CHANNELS; i++)
+	{
+		if (chans[i] == PULSES_NO_PULSE)
+		{
+			noPulse = TRUE;
+			values[i] = center;
+		}
+		else
+		{
+			values[i] = pulses_serial_value(chans[i], center);
+		}
+	}
+	if (proto == PROTO_CRSF)
+	{
+		crsf_pack(pt->serial, values);
+		pt->serialLen = CRSF_FRAME_LEN;
+	}
+	else if (proto == PROTO_MULTI)
+	{
+		multi_pack(pt->serial, values, g_model.multiProtocol,
+				g_model.sub_protocol, g_model.multiRxNum, g_model.multiOption,
+				pulses_multi_flags());
+		pt->serialLen = MULTI_FRAME_LEN;
+	}
+	else
+	{
+		sbus_pack(pt->serial, values,
+				noPulse ? (SBUS_FLAG_FRAME_LOST | SBUS_FLAG_FAILSAFE) : 0);
+		pt->serialLen = SBUS_FRAME_LEN;
+		noPulse = FALSE;
+	}
+
+	pt->pword[0] = pulses_serial_period(proto);
+	pt->count = 1;
+	pt->trnCount = 0;
+	pt->len = pt->pword[0];
+	pt->silent = noPulse;
+	pt->seq = chan_frame_seq;
+}
+
+/**
+  * @brief  Make the Multi module frame a failsafe frame.
+  * @note	Sent in place of a channel frame every MULTI_FAILSAFE_FRAMES,
+  * 		unless all channels are set to hold.
+  * @param  pt: The pulse table, with a Multi module frame.
+  * @retval None.
+  */
+static void pulses_multi_failsafe(PulseTable *pt)
+{
+	uint16_t values[SBUS_CHANNELS];
+	bool set = FALSE;
+
+	for (uint8_t i = 0; i < SBUS_CHANNELS; i++)
+	{
+		volatile FailsafeData *fs = &g_model.failsafe[i];
+		uint16_t v = MULTI_FAILSAFE_HOLD;
+
+		if (fs->mode == FAILSAFE_FIXED)
+		{
+			// Clear of the hold and no pulse values.
+			v = pulses_serial_value(fs->value * RESX / 100, MULTI_CENTER);
+			if (v < 1) v = 1;
+			if (v > MULTI_FAILSAFE_HOLD - 1) v = MULTI_FAILSAFE_HOLD - 1;
+		}
+		else if (fs->mode == FAILSAFE_NOPULSE)
+		{
+			v = MULTI_FAILSAFE_NOPULSE;
+		}
+		if (v != MULTI_FAILSAFE_HOLD)
+			set = TRUE;
+		values[i] = v;
+	}
+
+	if (set)
+		multi_pack_failsafe(pt->serial, values, g_model.multiProtocol,
+				g_model.sub_protocol, g_model.multiRxNum, g_model.multiOption,
+				pulses_multi_flags());
+}
+
+/**
+  * @brief  Configure the trainer port and TIM3 in PPM output mode.
+  * @note	TIM3 CH2 drives the pin, held at the stop level until
+  * 		pulses_run() starts the stream.
+  * @param  None.
   * @retval None.
   */
 void pulses_set_trainer_port_ppm()
 {
 	GPIO_InitTypeDef gpioInit;
+	TIM_OCInitTypeDef timOcInit;
+	DMA_InitTypeDef dmaInit;
 
-	GPIO_ResetBits(GPIOA, PPM_IN);
-	gpioInit.GPIO_Mode = GPIO_Mode_Out_PP;
+	// Stop the capture
+	TIM_Cmd(TIM3, DISABLE);
+	DMA_Cmd(DMA1_Channel3, DISABLE);
+	TIM3->SMCR &= (uint16_t)~TIM_SMCR_SMS;
+	ppmInValid = 0;
+
+	TIM_OCStructInit(&timOcInit);
+	timOcInit.TIM_OutputState = TIM_OutputState_Enable;
+	TIM_OC2Init(TIM3, &timOcInit);
+	TIM_ForcedOC2Config(TIM3, g_model.pulsePol ? TIM_ForcedAction_Active : TIM_ForcedAction_InActive);
+	TIM_SetCompare2(TIM3, 0);
+
+	// DMA1 channel 3 (TIM3_UP): trainer stream durations into TIM3 ARR,
+	// pointed at the table by pulses_run().
+	DMA_DeInit(DMA1_Channel3);
+	DMA_StructInit(&dmaInit);
+	dmaInit.DMA_PeripheralBaseAddr = (uint32_t) &TIM3->ARR;
+	dmaInit.DMA_MemoryBaseAddr = (uint32_t) &pulse_tables[0].pword[PULSES_STREAM_SIZE];
+	dmaInit.DMA_DIR = DMA_DIR_PeripheralDST;
+	dmaInit.DMA_BufferSize = 1;
+	dmaInit.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dmaInit.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	dmaInit.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	dmaInit.DMA_Priority = DMA_Priority_VeryHigh;
+	DMA_Init(DMA1_Channel3, &dmaInit);
+	TIM_DMACmd(TIM3, TIM_DMA_Update, ENABLE);
+
+	gpioInit.GPIO_Mode = GPIO_Mode_AF_PP;
 	gpioInit.GPIO_Pin = PPM_IN;
 	gpioInit.GPIO_Speed = GPIO_Speed_50MHz;
 	GPIO_Init(GPIOA, &gpioInit);
 
-	TIM_Cmd(TIM2, DISABLE);
+	trainer_out = TRUE;
 }
 
 /**
-  * @brief  Configure the trainer port and ISR in PPM input mode.
-  * @note
+  * @brief  Configure the trainer port and TIM3 in PPM input mode.
+  * @note	Each falling edge captures the time since the previous one
+  * 		into CCR2 and resets the counter (as in PWM input mode). The
+  * 		update of that reset has DMA1 channel 3 copy CCR2 into
+  * 		ppm_in_ring, decoded by pulses_trainer_decode().
   * @param  None.
   * @retval None.
   */
 void pulses_set_trainer_port_capture()
 {
 	GPIO_InitTypeDef gpioInit;
+	TIM_ICInitTypeDef timIcInit;
+	DMA_InitTypeDef dmaInit;
+
+	TIM_Cmd(TIM3, DISABLE);
+	DMA_Cmd(DMA1_Channel3, DISABLE);
+	trainer_out = FALSE;
 
 	GPIO_ResetBits(GPIOA, PPM_IN);
 	gpioInit.GPIO_Mode = GPIO_Mode_IPU;
@@ -350,130 +1105,217 @@ void pulses_set_trainer_port_capture()
 	gpioInit.GPIO_Speed = GPIO_Speed_50MHz;
 	GPIO_Init(GPIOA, &gpioInit);
 
-
-	TIM_SetAutoreload(TIM3, 30000);
-    TIM_SetCounter(TIM3, 0);
+	TIM_ICStructInit(&timIcInit);
+	timIcInit.TIM_Channel = TIM_Channel_2;
+	timIcInit.TIM_ICPolarity = TIM_ICPolarity_Falling;
+	timIcInit.TIM_ICSelection = TIM_ICSelection_DirectTI;
+	timIcInit.TIM_ICFilter = 0x0F;
+	TIM_ICInit(TIM3, &timIcInit);
+	TIM_SelectInputTrigger(TIM3, TIM_TS_TI2FP2);
+	TIM_SelectSlaveMode(TIM3, TIM_SlaveMode_Reset);
+
+	// DMA1 channel 3 (TIM3_UP): CCR2 into the ring, circular.
+	DMA_DeInit(DMA1_Channel3);
+	DMA_StructInit(&dmaInit);
+	dmaInit.DMA_PeripheralBaseAddr = (uint32_t) &TIM3->CCR2;
+	dmaInit.DMA_MemoryBaseAddr = (uint32_t) ppm_in_ring;
+	dmaInit.DMA_DIR = DMA_DIR_PeripheralSRC;
+	dmaInit.DMA_BufferSize = PPM_IN_RING_LEN;
+	dmaInit.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dmaInit.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	dmaInit.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	dmaInit.DMA_Mode = DMA_Mode_Circular;
+	dmaInit.DMA_Priority = DMA_Priority_High;
+	DMA_Init(DMA1_Channel3, &dmaInit);
+	TIM_DMACmd(TIM3, TIM_DMA_Update, ENABLE);
+
+	ppm_in_tail = 0;
+	ppmInState = 0;
+	ppmInValid = 0;
+
+	TIM_SetAutoreload(TIM3, 0xFFFF);
+	TIM_SetCounter(TIM3, 0);
+	DMA_Cmd(DMA1_Channel3, ENABLE);
 	TIM_Cmd(TIM3, ENABLE);
 }
 
 /**
-  * @brief  Timer 2 Interrupt Handler
-  * @note	Used as a time base for pulse generation.
-  * 		The overflow count is set by this handler based on the duration of each pulse.
-  * 		1us time base
-  * @param  None
-  * @retval None
+  * @brief  Make a complete trainer frame the g_ppmIns values.
+  * @note	Each channel is the median of its last three widths, which
+  * 		rejects single frame glitches.
+  * @param  n: Channels in the frame.
+  * @retval None.
   */
-void TIM2_IRQHandler(void)
+static void pulses_trainer_commit(uint8_t n)
 {
-    static uint8_t   pulsePol;
-    static uint16_t *pulsePtr = pulses_1us.pword;
+	for (uint8_t i = 0; i < NUM_PPM; i++)
+	{
+		uint16_t a = ppm_in_frame[i];
+		uint16_t b, c, med;
 
-    // For measuring the latency - difference between current count and desired
-    int16_t dt = TIM2->CNT /*TIM_GetCounter(TIM2)*/ - *(pulsePtr-1);
+		if (i >= n)
+		{
+			g_ppmIns[i] = 0;
+			continue;
+		}
 
-    TIM2->SR = (uint16_t)~TIM_FLAG_CC1; /* TIM_ClearITPendingBit(TIM2, TIM_FLAG_CC1); */
+		// Start the history afresh after a signal loss.
+		if (!ppmInValid)
+			ppm_in_hist[i][0] = ppm_in_hist[i][1] = a;
 
-    // Toggle the output bit.
-    if(pulsePol)
-    {
-    	GPIOA->BSRR = PPM_OUT; /*GPIO_SetBits(GPIOA, PPM_OUT);*/
-    	if (trainer_out)
-    		GPIOA->BSRR = PPM_IN; /* GPIO_SetBits(GPIOA, PPM_IN);*/
-        pulsePol = 0;
-    }
-    else
-    {
-    	GPIOA->BRR = PPM_OUT; /* GPIO_ResetBits(GPIOA, PPM_OUT); */
-    	if (trainer_out)
-    		GPIOA->BRR = PPM_IN; /*GPIO_ResetBits(GPIOA, PPM_IN);*/
-        pulsePol = 1;
-    }
+		b = ppm_in_hist[i][0];
+		c = ppm_in_hist[i][1];
+		ppm_in_hist[i][1] = b;
+		ppm_in_hist[i][0] = a;
 
-    // Store the min / max latency.
-	if ( (uint8_t)dt > g_latency.g_tmr1Latency_max) g_latency.g_tmr1Latency_max = dt ;    // max has leap, therefore vary in length
-	if ( (uint8_t)dt < g_latency.g_tmr1Latency_min) g_latency.g_tmr1Latency_min = dt ;    // max has leap, therefore vary in length
+		if (a > b) { med = a; a = b; b = med; }
+		med = (c < a) ? a : (c > b) ? b : c;
 
-	// If we're at the end of the sequence
-    if (*pulsePtr == 0)
-    {
-    	// Go back to the beginning.
-        pulsePtr = pulses_1us.pword;
-        // Set initial polarity of the output level to the inverse
-        pulsePol = !g_model.pulsePol;
+		// -700 - 700 Max
+		g_ppmIns[i] = ((int16_t)med - PPM_CENTER) * (g_eeGeneral.PPM_Multiplier + 10) / 10; // +/- 700 != 512, but close enough.
+	}
+}
 
-        // Pause the timer whilst we set the next sequence.
-        TIM2->CR1 &= (uint16_t)(~((uint16_t)TIM_CR1_CEN)); /*TIM_Cmd(TIM2, DISABLE);*/
+/**
+  * @brief  Decode the trainer intervals captured since the last call.
+  * @note	Called once per output frame from the pulse ISR. A sync gap
+  * 		after PPM_IN_MIN_CHANNELS or more in range channels completes a
+  * 		frame, an out of range interval drops the frame in progress.
+  * 		Without a valid frame for PPM_IN_TIMEOUT the signal is lost,
+  * 		ppmInValid clears and the mixer uses the local sticks. The time
+  * 		is counted in output frames, so the frame length is taken off.
+  * @param  frame_us: Length of the current output frame.
+  * @retval None.
+  */
+static void pulses_trainer_decode(uint16_t frame_us)
+{
+	uint8_t head = PPM_IN_RING_LEN - DMA1_Channel3->CNDTR;
+	bool valid = FALSE;
 
-        pulses_setup();
+	while (ppm_in_tail != head)
+	{
+		uint16_t w = ppm_in_ring[ppm_in_tail];
+		ppm_in_tail = (ppm_in_tail + 1) % PPM_IN_RING_LEN;
 
-        if ( (g_model.protocol == PROTO_PPM) || (g_model.protocol == PROTO_PPM16) )
-        {
-            // Reset and start the timer.
-        	TIM2->SR = (uint16_t)~TIM_FLAG_CC1; /*TIM_ClearITPendingBit(TIM2, TIM_FLAG_CC1);*/
-        	TIM2->CNT = 0; /*TIM_SetCounter(TIM2, 0);*/
-        	TIM2->CCR1 = PPM_STOP_LEN; /*TIM_SetCompare1(TIM2, PPM_STOP_LEN);*/
-        	TIM2->CR1 |= TIM_CR1_CEN; /*TIM_Cmd(TIM2, ENABLE);*/
-        }
-    }
-    else
-    {
-        // Set the compare value for the next pulse.
-    	TIM2->CCR1 = *pulsePtr; /*TIM_SetCompare1(TIM2, *pulsePtr);*/
-    	pulsePtr++;
-    }
+		if (w >= PPM_IN_SYNC_LEN)
+		{
+			if (ppmInState > PPM_IN_MIN_CHANNELS)
+			{
+				pulses_trainer_commit(ppmInState - 1);
+				valid = TRUE;
+			}
+			ppmInState = 1;
+		}
+		else if (ppmInState && w >= PPM_CENTER - PPM_IN_RANGE && w <= PPM_CENTER + PPM_IN_RANGE)
+		{
+			// Channels past NUM_PPM are ignored.
+			if (ppmInState <= NUM_PPM)
+			{
+				ppm_in_frame[ppmInState - 1] = w;
+				ppmInState++;
+			}
+		}
+		else
+		{
+			ppmInState = 0; // not triggered
+		}
+	}
 
-    heartbeat |= HEART_TIMER_PULSES;
+	if (valid)
+	{
+		ppmInValid = TRUE;
+		ppm_in_left = PPM_IN_TIMEOUT;
+	}
+	else if (ppmInValid && ppm_in_left > frame_us)
+	{
+		ppm_in_left -= frame_us;
+	}
+	else if (ppmInValid)
+	{
+		ppmInValid = FALSE;
+		for (uint8_t i = 0; i < NUM_PPM; i++)
+			g_ppmIns[i] = 0;
+	}
 }
 
 /**
-  * @brief  Timer 3 Interrupt Handler
-  * @note	Used as a time base for PPM pulse input (trainer port).
-  *         Timer3 used for PPM_IN pulse width capture. Counter running at 16MHz / 8 = 2MHz
-  *         equating to one count every half millisecond. (2 counts = 1ms). Control channel
-  *         count delta values thus can range from about 1600 to 4400 counts (800us to 2200us),
-  *         corresponding to a PPM signal in the range 0.8ms to 2.2ms (1.5ms at center).
-  *         (The timer is free-running and is thus not reset to zero at each capture interval.)
+  * @brief  PPM DMA (TIM2_UP) completion Interrupt Handler
+  * @note	The last duration of the frame, the final stop pulse, has just
+  * 		started. Queues the newest pulse table behind it, so the timer
+  * 		never stops.
   * @param  None
   * @retval None
   */
-void TIM3_IRQHandler(void)
+void DMA1_Channel2_IRQHandler(void)
 {
-    static uint16_t lastCapt = 0;
-    uint16_t capture = TIM_GetCapture1(TIM3);
-    int16_t val = (capture - lastCapt) / 2;
-	int16_t PPM_range;
+    uint32_t perf = perf_start();
+    // Time left of the current stop pulse, until the next frame starts.
+    uint16_t dt = TIM2->CNT;
+    uint16_t left = TIM2->ARR - dt;
+    bool silent = pulses_live->silent;
+    PulseTable *queued;
+
+    DMA1->IFCR = DMA1_FLAG_GL2;
+
+    // Store the min / max latency (us since the stop pulse started).
+    if (dt > 0xFF) dt = 0xFF;
+    if ( (uint8_t)dt > g_latency.g_tmr1Latency_max) g_latency.g_tmr1Latency_max = dt ;
+    if ( (uint8_t)dt < g_latency.g_tmr1Latency_min) g_latency.g_tmr1Latency_min = dt ;
+
+    pulses_frame_consume();
 
-    lastCapt = capture;
+    if (!pulses_live->serialLen && pulses_live->silent != silent)
+        pulses_set_silent(pulses_live->silent);
 
-    // We process g_ppmIns right here to make servo movement as smooth as possible
-    // while under trainee control
-    if(ppmInState && ppmInState <= 8)
+    DMA1_Channel2->CCR &= (uint16_t)~DMA_CCR1_EN;
+    DMA1_Channel2->CMAR = (uint32_t) pulses_live->pword;
+    DMA1_Channel2->CNDTR = pulses_live->count;
+    DMA1_Channel2->CCR |= DMA_CCR1_EN;
+
+    // The trainer stream has the same length and started just before,
+    // so it is in its final stop pulse too.
+    if (trainer_out && pulses_live->trnCount)
     {
-    	PPM_range = g_model.extendedLimits ? PPM_LIMIT_EXTENDED : PPM_LIMIT_NORMAL;   // range of 0.5 - 2.5ms or  0.8 - 2.2ms
-    	val -= PPM_CENTER;
-        if (val > -PPM_range && val < PPM_range)
-        {
-        	// -700 - 700 Max
-            g_ppmIns[ppmInState++ - 1] = val * (g_eeGeneral.PPM_Multiplier + 10) / 10; // +/- 700 != 512, but close enough.
-        }
-        else
-        {
-            ppmInState = 0; // not triggered
-        }
+        DMA1_Channel3->CCR &= (uint16_t)~DMA_CCR1_EN;
+        DMA1_Channel3->CMAR = (uint32_t) &pulses_live->pword[PULSES_STREAM_SIZE];
+        DMA1_Channel3->CNDTR = pulses_live->trnCount;
+        DMA1_Channel3->CCR |= DMA_CCR1_EN;
     }
-    else
+
+    if (!trainer_out)
     {
-        if(val > 4000 && val < 16000)
-        {
-            ppmInState = 1; // triggered
-            TIM_SetCounter(TIM3, 0);
-            //last_cap = 0;
-        }
+        uint32_t perfTrn = perf_start();
+        pulses_trainer_decode(pulses_live->len);
+        perf_record(PERF_TIM3, perfTrn);
     }
 
-    if (TIM_GetITStatus(TIM3, TIM_IT_CC2) != RESET)
+    if (pulses_live->silent)
+    {
+        // Nothing goes out, the receiver goes to its own failsafe.
+    }
+    else if (pulses_live->serialLen)
+    {
+        // A serial frame goes out as its period starts. A CRSF reply
+        // comes after it, anything half received before is dropped.
+        if (Current_protocol == PROTO_CRSF)
+            crsf_rx_reset();
+        usart_dma_send(pulses_live->serial, pulses_live->serialLen);
+        perf_trace_edge(pulses_live->seq, perf);
+    }
+    else
     {
-        TIM_ClearITPendingBit(TIM3, TIM_FLAG_CC2);
+        // The next frame's first edge will carry the consumed frame.
+        perf_trace_edge(pulses_live->seq,
+        		perf + left * (SystemCoreClock / 1000000));
     }
+
+    // Have the mixer and the next table done before the queued frame's
+    // final stop pulse, where this interrupt picks up the next table.
+    // That is at most PPM_MAX_FRAME_LEN + PPM_STOP_LEN (60.65ms) away.
+    queued = pulses_live;
+    sticks_frame_sync(left + queued->len - queued->pword[queued->count - 1]);
+
+    heartbeat |= HEART_TIMER_PULSES;
+
+    perf_record(PERF_TIM2, perf);
 }
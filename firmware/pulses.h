@@ -19,11 +19,20 @@
 #ifndef PULSES_H
 #define PULSES_H
 
+#include <stdbool.h>
+
 #define PPM_LIMIT_NORMAL	500 // +/- of PPM_CENTER [us]
 #define PPM_LIMIT_EXTENDED	800 // +/- of PPM_CENTER [us]
 
 void pulses_init(void);
+volatile int16_t *pulses_frame_back(void);
+void pulses_frame_publish(volatile int16_t *frame);
+uint16_t pulses_get_frame_rate(bool worst);
+bool pulses_is_serial(uint8_t proto);
+void pulses_failsafe_changed(void);
 
 extern volatile struct t_latency g_latency;
+extern volatile struct t_frame_stats g_frameStats;
+extern volatile uint8_t g_multiBind;
 
 #endif // PULSES_H
@@ -0,0 +1,68 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Packs channel values into SBUS frames:
+ * start byte, 16 channels of 11 bits (LSB first, little endian),
+ * the flags byte and the end byte. 25 bytes at 100k 8E2.
+ *
+ * The signal is inverted on the wire. The USART cannot invert it,
+ * so the receiver needs an inverter on the serial TX line.
+ *
+ */
+
+#include "sbus.h"
+
+/**
+  * @brief  Pack 16 11 bit channel values.
+  * @note	Also the channel layout of the CRSF and Multiprotocol frames.
+  * @param  ptr: Where the SBUS_CHANNELS_LEN bytes go.
+  * @param  values: SBUS_CHANNELS values, 0 - SBUS_MAX.
+  * @retval None.
+  */
+void sbus_pack_channels(uint8_t *ptr, const uint16_t *values)
+{
+	uint32_t bits = 0;
+	uint8_t n = 0;
+
+	for (uint8_t i = 0; i < SBUS_CHANNELS; i++)
+	{
+		bits |= (uint32_t)(values[i] & SBUS_MAX) << n;
+		n += 11;
+		while (n >= 8)
+		{
+			*ptr++ = (uint8_t)bits;
+			bits >>= 8;
+			n -= 8;
+		}
+	}
+}
+
+/**
+  * @brief  Build an SBUS frame.
+  * @note
+  * @param  frame: Where the SBUS_FRAME_LEN bytes go.
+  * @param  values: SBUS_CHANNELS values, 0 - SBUS_MAX.
+  * @param  flags: SBUS_FLAG_ bits.
+  * @retval None.
+  */
+void sbus_pack(uint8_t *frame, const uint16_t *values, uint8_t flags)
+{
+	frame[0] = SBUS_START_BYTE;
+	sbus_pack_channels(&frame[1], values);
+	frame[1 + SBUS_CHANNELS_LEN] = flags;
+	frame[2 + SBUS_CHANNELS_LEN] = SBUS_END_BYTE;
+}
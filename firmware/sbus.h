@@ -0,0 +1,45 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+#ifndef _SBUS_H
+#define _SBUS_H
+
+ /*
+  * SBUS frame packing.
+  */
+
+#include <stdint.h>
+
+#define SBUS_BAUDRATE		100000	// 8E2
+#define SBUS_FRAME_LEN		25
+#define SBUS_CHANNELS		16
+#define SBUS_CHANNELS_LEN	22		// 16 x 11 bits
+#define SBUS_START_BYTE		0x0F
+#define SBUS_END_BYTE		0x00
+#define SBUS_PERIOD			14000	// us
+#define SBUS_PERIOD_FAST	7000	// us
+
+#define SBUS_CENTER			992		// 1500us
+#define SBUS_MAX			2047
+
+// Flags byte
+#define SBUS_FLAG_CH17		0x01
+#define SBUS_FLAG_CH18		0x02
+#define SBUS_FLAG_FRAME_LOST	0x04
+#define SBUS_FLAG_FAILSAFE	0x08
+
+void sbus_pack_channels(uint8_t *ptr, const uint16_t *values);
+void sbus_pack(uint8_t *frame, const uint16_t *values, uint8_t flags);
+
+#endif // _SBUS_H
@@ -27,6 +27,8 @@
 #include "lcd.h"
 #include "tasks.h"
 #include "settings.h"
+#include "mixer.h"
+#include "sticks.h"
 
 #define DPUTS
 #include "debug.h"
@@ -149,6 +151,7 @@ void settings_preset_general() {
 	g_eeGeneral.inactivityTimer = 10;
 	if (g_eeGeneral.currModel < MAX_MODELS)
 		g_eeGeneral.currModel = MAX_MODELS - 1;
+	sticks_cal_compile();
 }
 
 /**
@@ -158,7 +161,8 @@ void settings_preset_general() {
  */
 void settings_preset_current_model_mixers() {
 	bzero((void*) &g_model.mixData, sizeof(g_model.mixData));
-	for (int mx = 0; mx < NUM_CHNOUT; mx++) {
+	// CH9-CH16 get no lines, they stay centred until given a source
+	for (int mx = 0; mx < NUM_PPM_CHNOUT; mx++) {
 		MixData* md = &g_model.mixData[mx];
 		md->destCh = mx + 1;
 		md->srcRaw = mx + 1;
@@ -169,6 +173,7 @@ void settings_preset_current_model_mixers() {
 			md->swtch = SWITCH_SWA + mx - 6;
 		}
 	}
+	mixer_compile();
 }
 
 /**
@@ -187,6 +192,7 @@ void settings_preset_current_model_limits() {
 		p->min = -100;
 		p->max = 100;
 	}
+	mixer_compile();
 }
 
 /**
@@ -201,12 +207,14 @@ void settings_preset_current_model() {
 	g_model.name[MODEL_NAME_LEN - 2] = '0' + (g_eeGeneral.currModel % 10);
 	g_model.name[MODEL_NAME_LEN - 1] = 0;
 	g_model.protocol = PROTO_PPM;
-	g_model.ppmNCH = NUM_CHNOUT;
+	g_model.ppmNCH = NUM_PPM_CHNOUT;
 	g_model.ppmFrameLength = 0;
 	g_model.ppmDelay = 2;
 	g_model.ppmStart = 0;
 	g_model.extendedLimits = FALSE;
 	g_model.pulsePol = 0;
+	g_model.crsfRate = 2; // 250Hz
+	g_model.modelVersion = MDVERS;
 	settings_preset_current_model_mixers();
 	settings_preset_current_model_limits();
 }
@@ -225,7 +233,8 @@ void settings_load_current_model() {
 	eeprom_read(modelAddr, sizeof(g_model),
 			(void*) &g_model);
 	uint16_t chksum = checksum_current_model();
-	if (chksum != g_model.chkSum) {
+	// A model saved with another ModelData layout is reset too
+	if (chksum != g_model.chkSum || g_model.modelVersion != MDVERS) {
 		dputs("model CS bad on load ");
 		dputs_hex4(chksum);
 		dputs(" ");
@@ -246,6 +255,9 @@ void settings_load_current_model() {
 	// make sure the string is terminated, by all means!
 	g_model.name[sizeof(g_model.name) - 1] = 0;
 	currModel = g_eeGeneral.currModel;
+	mixer_compile();
+	if (mixer_get_cycle_channels())
+		gui_popup(GUI_MSG_MIX_CYCLE, 0);
 	// model is now valid (sane)
 	g_modelInvalid = 0;
 }
@@ -325,6 +337,27 @@ static void settings_process(uint32_t data) {
 	task_schedule(TASK_PROCESS_EEPROM, 0, 1000);
 }
 
+/**
+ * @brief  Convert general settings saved before the stick filters
+ * @note   That layout ended with chkSum where stickFilter now starts,
+ *         so it is recognised by its own checksum. The filters are
+ *         preset to off and settings_process() saves the new layout.
+ * @param  None
+ * @retval 1 if g_eeGeneral was in the old layout and has been converted
+ */
+static uint8_t settings_upgrade_general(void) {
+	const uint16_t oldLength = offsetof(EEGeneral, stickFilter);
+	volatile uint8_t *oldChkSum = (volatile uint8_t *) g_eeGeneral.stickFilter;
+
+	if (eeprom_calc_chksum((void*) &g_eeGeneral, oldLength)
+			!= (oldChkSum[0] | (oldChkSum[1] << 8)))
+		return 0;
+
+	dputs("eeprom general upgraded\r\n");
+	bzero((void*) g_eeGeneral.stickFilter, sizeof(g_eeGeneral.stickFilter));
+	return 1;
+}
+
 /**
  * @brief  Initialize the settings
  * @note
@@ -338,7 +371,7 @@ void settings_init(void) {
 	while( !eeprom_read(0, sizeof(EEGeneral), (void*) &g_eeGeneral) && --cnt ) ;
 	uint16_t chksum =
 			eeprom_calc_chksum((void*) &g_eeGeneral, sizeof(EEGeneral) - 2);
-	if (chksum != g_eeGeneral.chkSum) {
+	if (chksum != g_eeGeneral.chkSum && !settings_upgrade_general()) {
 		dputs("eeprom general CS bad ");
 		dputs_dec(2);
 		dputs_hex4(chksum);
@@ -350,6 +383,7 @@ void settings_init(void) {
 		// perhaps it just fails on first access?
 		eeprom_read(0, sizeof(EEGeneral), (void*) &g_eeGeneral);
 	}
+	sticks_cal_compile();
 
 	// now register eeprom update task
 	task_register(TASK_PROCESS_EEPROM, settings_process);
@@ -16,10 +16,24 @@
 /* Description:
  *
  * This is an IRQ and DMA driven analogue sampler.
- * The DMA completion routine invokes the mixer directly.
+ * The DMA completion routine snapshots the samples and pends PendSV,
+ * which scales the sticks and runs the mixer at MIXER_IRQ_PRIORITY.
+ * With STICKS_OVERSAMPLE > 1 TIM4 starts that many scans per output frame
+ * (the period follows the measured frame rate) into a DMA ring of as many
+ * scans. The ring then always holds the last frame's worth of samples and
+ * is averaged once per frame as the mixer stage is started, with no
+ * interrupt per scan.
+ * The mixer stage is phase locked to the PPM frame: the pulse ISR calls
+ * sticks_frame_sync() as each frame starts, which arms the TIM6 one-shot
+ * to take the sticks (and pend PendSV) a guard time before the next frame
+ * is built. The guard follows the measured mixer run time.
+ * sticks_filter() then applies the per axis stickFilter settings
+ * (IIR, deadband, hysteresis) before the mixer sees stick_data.
  * Scaling of the data for the GUI is done in a main loop
  * task.
  * Calibration is also handled through an API to this module.
+ * The battery is not in the scan: a 1Hz task reads it as an injected
+ * conversion, averages it and estimates the time left to vBatWarn.
  *
  */
 
@@ -32,12 +46,58 @@
 #include "mixer.h"
 #include "myeeprom.h"
 #include "art6.h"
+#include "perf.h"
+#include <string.h>
 
 volatile uint16_t adc_data[STICK_ADC_CHANNELS];
 volatile int16_t stick_data[STICK_ADC_CHANNELS];
 
+// adc_data as captured at the end of the last scan, input to the mixer stage.
+static uint16_t adc_frame[STICK_ADC_CHANNELS];
+
+#if STICKS_OVERSAMPLE > 1
+// DMA ring of the last STICKS_OVERSAMPLE scans, averaged per frame.
+static volatile uint16_t adc_ring[STICKS_OVERSAMPLE][STICK_SCAN_CHANNELS];
+static uint32_t frame_stamp;				// DWT_CYCCNT at the last frame sync
+#endif
+
 CAL_STATE cal_state = CAL_OFF;
 
+// Calibration compiled by sticks_cal_compile(), Q16 RESX / span.
+typedef struct
+{
+	int16_t centre;
+	int32_t recipPos;			// Above the centre, 1 / (max - centre)
+	int32_t recipNeg;			// Below the centre, 1 / (centre - min)
+} StickScale;
+
+static StickScale stick_scale[STICK_ADC_CHANNELS];
+
+// Filter stage state, per StickFilter.
+typedef struct
+{
+	int32_t iir;				// IIR output, RESX << STICKS_IIR_FRAC
+	int16_t out;				// Hysteresis output
+	uint8_t deadband;			// Deadband the gain was made for
+	uint16_t gain;				// Q15 RESX / (RESX - deadband)
+} StickFilterState;
+
+static StickFilterState stick_filter[NUM_STICK_FILTERS];
+
+// Battery, moving average of the injected samples and slope history.
+static uint16_t batt_ring[BATT_AVG_LEN];
+static uint32_t batt_sum;
+static uint8_t batt_idx;
+static uint8_t batt_secs;
+static uint16_t batt_hist[BATT_SLOPE_LEN];	// mV, one per minute
+static uint8_t batt_hist_len;
+static uint16_t batt_mv;
+static uint16_t batt_minutes = BATT_MINUTES_UNKNOWN;
+
+// Mixer stage scheduling against the PPM frame.
+static uint32_t mixer_peak;					// Decaying peak mixer run time (cycles)
+static volatile uint16_t sync_guard_us = STICKS_SYNC_MARGIN + STICKS_SCAN_US;
+
 /**
  * @brief  Update sticks' GUI. All processing in IRQ.
  * @note   Called from the scheduler.
@@ -49,6 +109,65 @@ static void sticks_process(uint32_t data) {
 	task_schedule(TASK_PROCESS_STICKS, 0, 20);
 }
 
+/**
+ * @brief  Convert the averaged battery sample to mV.
+ * @note   3100 counts is 12.9V, trimmed by vBatCalib (%).
+ * @param  None
+ * @retval None
+ */
+static void sticks_battery_scale(void) {
+	uint32_t avg = batt_sum / BATT_AVG_LEN;
+
+	adc_data[STICK_BAT] = avg;
+	batt_mv = avg * 12900 / 3100 * g_eeGeneral.vBatCalib / 100;
+}
+
+/**
+ * @brief  Sample and filter the battery voltage.
+ * @note   Called from the scheduler once a second. Picks up the previous
+ *         injected conversion and starts the next one.
+ *         Once a minute the average goes into the slope history; the
+ *         drop over the history gives the minutes left to vBatWarn.
+ * @param  data: Not used.
+ * @retval None
+ */
+static void sticks_battery_process(uint32_t data) {
+	if (ADC_GetFlagStatus(ADC1, ADC_FLAG_JEOC)) {
+		uint16_t raw = ADC_GetInjectedConversionValue(ADC1,
+				ADC_InjectedChannel_1);
+
+		ADC_ClearFlag(ADC1, ADC_FLAG_JEOC);
+		batt_sum += raw - batt_ring[batt_idx];
+		batt_ring[batt_idx] = raw;
+		batt_idx = (batt_idx + 1) % BATT_AVG_LEN;
+		sticks_battery_scale();
+	}
+	ADC_SoftwareStartInjectedConvCmd(ADC1, ENABLE);
+
+	if (++batt_secs >= 60) {
+		uint16_t warn_mv = g_eeGeneral.vBatWarn * 100;
+		uint16_t oldest;
+
+		batt_secs = 0;
+		if (batt_hist_len < BATT_SLOPE_LEN)
+			batt_hist_len++;
+		memmove(&batt_hist[1], &batt_hist[0],
+				(BATT_SLOPE_LEN - 1) * sizeof(batt_hist[0]));
+		batt_hist[0] = batt_mv;
+
+		oldest = batt_hist[batt_hist_len - 1];
+		if (batt_mv <= warn_mv)
+			batt_minutes = 0;
+		else if (batt_hist_len > 1 && oldest > batt_mv)
+			batt_minutes = (uint32_t)(batt_mv - warn_mv)
+					* (batt_hist_len - 1) / (oldest - batt_mv);
+		else
+			batt_minutes = BATT_MINUTES_UNKNOWN;
+	}
+
+	task_schedule(TASK_PROCESS_BATTERY, 0, 1000);
+}
+
 /**
  * @brief  Initialise the stick scanning.
  * @note   Starts the ADC continuous sampling.
@@ -61,7 +180,9 @@ void sticks_init(void) {
 	GPIO_InitTypeDef gpioInit;
 	NVIC_InitTypeDef nvicInit;
 	TIM_TimeBaseInitTypeDef timInit;
+#if STICKS_OVERSAMPLE > 1
 	TIM_OCInitTypeDef timOC;
+#endif
 
 	int i;
 
@@ -80,16 +201,28 @@ void sticks_init(void) {
 	ADC_StructInit(&adcInit);
 	adcInit.ADC_ContinuousConvMode = DISABLE;
 	adcInit.ADC_ScanConvMode = ENABLE;
+#if STICKS_OVERSAMPLE > 1
 	adcInit.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T4_CC4;
-	adcInit.ADC_NbrOfChannel = STICK_ADC_CHANNELS;
+#else
+	// Single scans are started by the frame sync timer.
+	adcInit.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+#endif
+	adcInit.ADC_NbrOfChannel = STICK_SCAN_CHANNELS;
 	ADC_Init(ADC1, &adcInit);
 
 	// Setup the regular channel cycle
-	for (i = 0; i < STICK_ADC_CHANNELS; ++i) {
+	for (i = 0; i < STICK_SCAN_CHANNELS; ++i) {
 		ADC_RegularChannelConfig(ADC1, ADC_Channel_0 + i, i + 1,
 				ADC_SampleTime_239Cycles5);
 	}
 
+	// The battery is a software started injected conversion.
+	ADC_InjectedSequencerLengthConfig(ADC1, 1);
+	ADC_InjectedChannelConfig(ADC1, ADC_Channel_0 + STICK_BAT, 1,
+			ADC_SampleTime_239Cycles5);
+	ADC_ExternalTrigInjectedConvConfig(ADC1, ADC_ExternalTrigInjecConv_None);
+	ADC_ExternalTrigInjectedConvCmd(ADC1, ENABLE);
+
 	// Enable ADC1 + DMA
 	ADC_Cmd(ADC1, ENABLE);
 	ADC_DMACmd(ADC1, ENABLE);
@@ -102,19 +235,42 @@ void sticks_init(void) {
 	while (ADC_GetCalibrationStatus(ADC1))
 		;
 
+	// Seed the battery average with a first reading.
+	ADC_SoftwareStartInjectedConvCmd(ADC1, ENABLE);
+	while (!ADC_GetFlagStatus(ADC1, ADC_FLAG_JEOC))
+		;
+	ADC_ClearFlag(ADC1, ADC_FLAG_JEOC);
+	batt_sum = 0;
+	for (i = 0; i < BATT_AVG_LEN; ++i) {
+		batt_ring[i] = ADC_GetInjectedConversionValue(ADC1,
+				ADC_InjectedChannel_1);
+		batt_sum += batt_ring[i];
+	}
+	sticks_battery_scale();
+
+#if STICKS_OVERSAMPLE == 1
 	nvicInit.NVIC_IRQChannel = DMA1_Channel1_IRQn;
 	nvicInit.NVIC_IRQChannelSubPriority = 1;
 	nvicInit.NVIC_IRQChannelPreemptionPriority = 1;
 	nvicInit.NVIC_IRQChannelCmd = ENABLE;
 	NVIC_Init(&nvicInit);
+#endif
+
+	// The mixer stage runs in PendSV, below the EEPROM and pulse interrupts.
+	NVIC_SetPriority(PendSV_IRQn, MIXER_IRQ_PRIORITY);
 
 	// DMA Configuration
 	DMA_DeInit(DMA1_Channel1);
 	DMA_StructInit(&dmaInit);
 	dmaInit.DMA_PeripheralBaseAddr = (uint32_t) &ADC1->DR;
+#if STICKS_OVERSAMPLE > 1
+	dmaInit.DMA_MemoryBaseAddr = (uint32_t) &adc_ring[0][0];
+	dmaInit.DMA_BufferSize = STICKS_OVERSAMPLE * STICK_SCAN_CHANNELS;
+#else
 	dmaInit.DMA_MemoryBaseAddr = (uint32_t) &adc_data[0];
+	dmaInit.DMA_BufferSize = STICK_SCAN_CHANNELS;
+#endif
 	dmaInit.DMA_DIR = DMA_DIR_PeripheralSRC;
-	dmaInit.DMA_BufferSize = STICK_ADC_CHANNELS;
 	dmaInit.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
 	dmaInit.DMA_MemoryInc = DMA_MemoryInc_Enable;
 	dmaInit.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
@@ -126,16 +282,19 @@ void sticks_init(void) {
 	// Configure and enable the DMA
 	DMA_Init(DMA1_Channel1, &dmaInit);
 	DMA_Cmd(DMA1_Channel1, ENABLE);
+#if STICKS_OVERSAMPLE == 1
 	DMA_ITConfig(DMA1_Channel1, DMA_IT_TC, ENABLE);
+#endif
 
+#if STICKS_OVERSAMPLE > 1
 	// TIM4 OC4 is ADC conversion trigger
 	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
 	TIM_DeInit(TIM4);
 
 	/* TIM4 init */
 	TIM_TimeBaseStructInit(&timInit);
-	timInit.TIM_Period = 20-1; /* 20 ms */
-	timInit.TIM_Prescaler = SystemCoreClock/1000 - 1; /* 1ms */
+	timInit.TIM_Period = STICKS_FRAME_US/STICKS_OVERSAMPLE - 1; /* until the first frame sync */
+	timInit.TIM_Prescaler = SystemCoreClock/1000000 - 1; /* 1us */
 	timInit.TIM_ClockDivision = 0x0;
 	timInit.TIM_CounterMode = TIM_CounterMode_Up;
 	TIM_TimeBaseInit(TIM4, &timInit);
@@ -148,75 +307,194 @@ void sticks_init(void) {
 	timOC.TIM_OCPolarity = TIM_OCPolarity_Low;
 	TIM_OC4Init(TIM4, &timOC);
 
-	/* TIM2 enable counter */
+	/* The frame sync changes the period, from the next scan on */
+	TIM_ARRPreloadConfig(TIM4, ENABLE);
+
+	/* TIM4 enable counter */
 	TIM_Cmd(TIM4, ENABLE);
+#endif
 
 	/* enable ADC triggering */
 	ADC_ExternalTrigConvCmd(ADC1, ENABLE);
 
+#if STICKS_OVERSAMPLE > 1
+	// Fill the ring once, the first frame must not average zeros.
+	while (!DMA_GetFlagStatus(DMA1_FLAG_TC1))
+		;
+	DMA_ClearFlag(DMA1_FLAG_TC1);
+#endif
+
+	// TIM6 one-shot schedules the mixer stage, 1us time base.
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM6, ENABLE);
+	TIM_DeInit(TIM6);
+	TIM_TimeBaseStructInit(&timInit);
+	timInit.TIM_Period = STICKS_FRAME_US - 1;
+	timInit.TIM_Prescaler = SystemCoreClock/1000000 - 1; /* 1us */
+	TIM_TimeBaseInit(TIM6, &timInit);
+	TIM_SelectOnePulseMode(TIM6, TIM_OPMode_Single);
+	TIM_ClearFlag(TIM6, TIM_FLAG_Update);
+	TIM_ITConfig(TIM6, TIM_IT_Update, ENABLE);
+
+	nvicInit.NVIC_IRQChannel = TIM6_DAC_IRQn;
+	nvicInit.NVIC_IRQChannelSubPriority = 0;
+	nvicInit.NVIC_IRQChannelPreemptionPriority = 1;
+	nvicInit.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&nvicInit);
+
+	// Free run until the pulses report the first frame.
+	TIM_Cmd(TIM6, ENABLE);
+
+	sticks_cal_compile();
+
 	task_register(TASK_PROCESS_STICKS, sticks_process);
 	task_schedule(TASK_PROCESS_STICKS, 0, 20);
+
+	ADC_SoftwareStartInjectedConvCmd(ADC1, ENABLE);
+	task_register(TASK_PROCESS_BATTERY, sticks_battery_process);
+	task_schedule(TASK_PROCESS_BATTERY, 0, 1000);
+}
+
+/**
+ * @brief  Get the Q16 reciprocal of a calibration span, scaled by RESX.
+ * @note   Rounded away from zero, so the scaled value is at most 1 LSB
+ *         above the division. A zero span gives 0, as the divide did.
+ * @param  span: max - centre or centre - min.
+ * @retval (RESX << 16) / span
+ */
+static int32_t sticks_cal_recip(int32_t span)
+{
+	if (span == 0)
+		return 0;
+	if (span < 0)
+		return -(int32_t)((((uint32_t)RESX << 16) + -span - 1) / -span);
+	return (((uint32_t)RESX << 16) + span - 1) / span;
+}
+
+/**
+ * @brief  Compile calData into the per channel scaling.
+ * @note   Must be called whenever calData changes. Built aside and
+ *         swapped in with interrupts off, so sticks_update() in the
+ *         mixer stage never sees a half written channel.
+ * @param  None
+ * @retval None
+ */
+void sticks_cal_compile(void)
+{
+	StickScale scale[STICK_SCAN_CHANNELS];
+	int i;
+
+	for (i = 0; i < STICK_SCAN_CHANNELS; ++i) {
+		volatile ADC_CAL *cal = &g_eeGeneral.calData[i];
+		StickScale *s = &scale[i];
+
+		s->centre = cal->centre;
+		s->recipPos = sticks_cal_recip(cal->max - cal->centre);
+		s->recipNeg = sticks_cal_recip(cal->centre - cal->min);
+	}
+
+	__disable_irq();
+	memcpy(stick_scale, scale, sizeof(scale));
+	__enable_irq();
 }
 
 /**
  * @brief  Update stick_data from adc_data
- * @note
+ * @note   Multiply and shift by the compiled calibration, the quotient
+ *         is truncated towards zero like the divide it replaces.
  * @param  None
  * @retval None
  */
 void sticks_update()
 {
 	// Scale channels to -RESX to +RESX
-	// For GUI purpose only.
-	for (int i = 0; i < STICK_ADC_CHANNELS; ++i) {
-		int tmp;
-		tmp = adc_data[i];
-		if (adc_data[i] >= g_eeGeneral.calData[i].centre) {
-			tmp -= g_eeGeneral.calData[i].centre;
-			tmp *= RESX;
-			stick_data[i] = tmp
-					/ (g_eeGeneral.calData[i].max
-							- g_eeGeneral.calData[i].centre);
+	for (int i = 0; i < STICK_SCAN_CHANNELS; ++i) {
+		StickScale *s = &stick_scale[i];
+		int32_t d = adc_frame[i] - s->centre;
+		int64_t p = (int64_t)d * ((d >= 0) ? s->recipPos : s->recipNeg);
+
+		stick_data[i] = (p >= 0) ? (int32_t)(p >> 16) : -(int32_t)(-p >> 16);
+	}
+}
+
+
+/**
+ * @brief  Filter stick_data for the mixer.
+ * @note   Per axis, in this order:
+ *         IIR: out += (in - out) / 2^iir, with STICKS_IIR_FRAC extra bits.
+ *         Deadband: values within +/-deadband become 0, the rest is
+ *         rescaled so the full throw is kept.
+ *         Hysteresis: the output only follows changes of more than
+ *         hysteresis, but always returns to the centre.
+ * @param  None
+ * @retval None
+ */
+void sticks_filter(void)
+{
+	for (int i = 0; i < NUM_STICK_FILTERS; ++i) {
+		volatile StickFilter *f = &g_eeGeneral.stickFilter[i];
+		StickFilterState *st = &stick_filter[i];
+		int32_t x = stick_data[i];
+		int32_t m;
+
+		if (f->iir) {
+			st->iir += (x * (1 << STICKS_IIR_FRAC) - st->iir) >> f->iir;
+			x = (st->iir + (1 << (STICKS_IIR_FRAC - 1))) >> STICKS_IIR_FRAC;
 		} else {
-			tmp = g_eeGeneral.calData[i].centre - tmp;
-			tmp *= -RESX;
-			stick_data[i] = tmp
-					/ (g_eeGeneral.calData[i].centre
-							- g_eeGeneral.calData[i].min);
+			st->iir = x * (1 << STICKS_IIR_FRAC);
 		}
+
+		if (f->deadband) {
+			if (st->deadband != f->deadband) {
+				st->deadband = f->deadband;
+				st->gain = ((uint32_t)RESX << 15) / (RESX - f->deadband);
+			}
+			m = (x < 0) ? -x : x;
+			m = (m > f->deadband) ? ((m - f->deadband) * st->gain) >> 15 : 0;
+			x = (x < 0) ? -m : m;
+		}
+
+		m = x - st->out;
+		if (x == 0 || m > f->hysteresis || m < -f->hysteresis)
+			st->out = x;
+
+		stick_data[i] = st->out;
 	}
 }
 
-
 /**
  * @brief  Update cal data after ADC conversion
- * @note
+ * @note   Only recompiles the scaling when calData moved.
  * @param  None
  * @retval None
  */
 static void cal_update()
 {
+	uint8_t changed = 0;
 	int i;
+
 	if (cal_state == CAL_LIMITS) {
 		for (i = 0; i < STICK_INPUT_CHANNELS; ++i) {
-			if (adc_data[i] < g_eeGeneral.calData[i].min)
-				g_eeGeneral.calData[i].min = adc_data[i];
-			if (adc_data[i] > g_eeGeneral.calData[i].max)
-				g_eeGeneral.calData[i].max = adc_data[i];
+			if (adc_frame[i] < g_eeGeneral.calData[i].min) {
+				g_eeGeneral.calData[i].min = adc_frame[i];
+				changed = 1;
+			}
+			if (adc_frame[i] > g_eeGeneral.calData[i].max) {
+				g_eeGeneral.calData[i].max = adc_frame[i];
+				changed = 1;
+			}
 		}
 	} else if (cal_state == CAL_CENTER) {
 		// Set the stick centres.
 		for (i = 0; i < STICKS_TO_CALIBRATE; ++i) {
-			g_eeGeneral.calData[i].centre = adc_data[i];
-		}
-
-		// Set the remaining centres.
-		for (i = STICKS_TO_CALIBRATE; i < STICK_INPUT_CHANNELS; ++i) {
-			g_eeGeneral.calData[i].centre = g_eeGeneral.calData[i].min
-					+ ((g_eeGeneral.calData[i].max
-							- g_eeGeneral.calData[i].min) / 2);
+			if (g_eeGeneral.calData[i].centre != adc_frame[i]) {
+				g_eeGeneral.calData[i].centre = adc_frame[i];
+				changed = 1;
+			}
 		}
 	}
+
+	if (changed)
+		sticks_cal_compile();
 }
 
 /**
@@ -226,21 +504,25 @@ static void cal_update()
  * @retval None
  */
 void sticks_calibrate(CAL_STATE state) {
-	cal_state = state;
+	int i;
 
 	if (state == CAL_LIMITS) {
-		int i;
 		for (i = 0; i < STICKS_TO_CALIBRATE; ++i) {
 			g_eeGeneral.calData[i].min = 0x7FFF;
 			g_eeGeneral.calData[i].max = 0;
 			g_eeGeneral.calData[i].centre = 2048;
 		}
-
-		// Battery
-		g_eeGeneral.calData[i].min = 0;
-		g_eeGeneral.calData[i].max = 3100;
-		g_eeGeneral.calData[i].centre = 1550;
+	} else if (state == CAL_CENTER) {
+		// The limits are final, set the remaining centres once.
+		for (i = STICKS_TO_CALIBRATE; i < STICK_INPUT_CHANNELS; ++i) {
+			g_eeGeneral.calData[i].centre = g_eeGeneral.calData[i].min
+					+ ((g_eeGeneral.calData[i].max
+							- g_eeGeneral.calData[i].min) / 2);
+		}
 	}
+
+	sticks_cal_compile();
+	cal_state = state;
 }
 
 /**
@@ -273,33 +555,185 @@ int16_t sticks_get_percent(STICK channel) {
 
 /**
  * @brief  Get the battery Voltage
- * @note
+ * @note   Moving average over BATT_AVG_LEN seconds.
  * @param
- * @retval battery voltage in 10mV
+ * @retval battery voltage in 100mV
  */
 uint16_t sticks_get_battery(void) {
-	uint16_t val = sticks_get_percent(STICK_BAT) * 129 / 100;
-	val = val * g_eeGeneral.vBatCalib / 100;
+	return batt_mv / 100;
+}
 
-	return val;
+/**
+ * @brief  Get the estimated battery time left.
+ * @note   From the voltage drop over the last BATT_SLOPE_LEN minutes.
+ * @param  None
+ * @retval Minutes until vBatWarn, BATT_MINUTES_UNKNOWN if not falling.
+ */
+uint16_t sticks_get_battery_minutes(void) {
+	return batt_minutes;
 }
 
 /**
- * @brief  This function handles the DMA end of transfer fro ADC read
- *          and processing of ADC stick data then calls the mixer.
+ * @brief  Get the measured lead of the mixer stage over the frame.
+ * @note
+ * @param  None
+ * @retval Guard time in us.
+ */
+uint16_t sticks_get_sync_guard(void) {
+	return sync_guard_us;
+}
+
+/**
+ * @brief  (Re)arm the TIM6 one-shot.
+ * @note
+ * @param  us: Delay until the mixer stage is started.
+ * @retval None
+ */
+static void sticks_arm(uint16_t us) {
+	if (us < 2)
+		us = 2;
+
+	TIM6->CR1 &= (uint16_t)~TIM_CR1_CEN;
+	TIM6->CNT = 0;
+	TIM6->ARR = us - 1;
+	TIM6->SR = (uint16_t)~TIM_FLAG_Update;
+	TIM6->CR1 |= TIM_CR1_CEN;
+}
+
+#if STICKS_OVERSAMPLE > 1
+/**
+ * @brief  Spread the oversampling scans over the output frame.
+ * @note   Frames longer than STICKS_FRAME_US (and a stopped output) keep
+ *         the 20ms spacing, the ring then averages the last 20ms.
+ * @param  frame_us: Measured output frame period.
+ * @retval None
+ */
+static void sticks_scan_period(uint32_t frame_us) {
+	uint32_t us = frame_us / STICKS_OVERSAMPLE;
+
+	if (us < STICKS_SCAN_MIN_US)
+		us = STICKS_SCAN_MIN_US;
+	if (us > STICKS_FRAME_US / STICKS_OVERSAMPLE)
+		us = STICKS_FRAME_US / STICKS_OVERSAMPLE;
+
+	// Preloaded, takes effect at the next scan.
+	TIM4->ARR = us - 1;
+}
+
+/**
+ * @brief  Average the DMA ring into the frame's samples.
+ * @note   Called from TIM6 once per frame. A scan in progress has only
+ *         overwritten whole samples, so each channel always averages its
+ *         last STICKS_OVERSAMPLE samples.
+ * @param  None
+ * @retval None
+ */
+static void sticks_decimate(void)
+{
+	int i, j;
+
+	for (i = 0; i < STICK_SCAN_CHANNELS; ++i) {
+		uint32_t sum = 0;
+
+		for (j = 0; j < STICKS_OVERSAMPLE; ++j)
+			sum += adc_ring[j][i];
+		adc_data[i] = sum / STICKS_OVERSAMPLE;
+		adc_frame[i] = adc_data[i];
+	}
+}
+#endif
+
+/**
+ * @brief  Phase lock the mixer stage to the output frame.
+ * @note   Called from the pulse ISR as a frame starts. The pulses cap
+ *         frames at PPM_MAX_FRAME_LEN (60ms) plus a stop pulse, so the
+ *         time always fits 16 bits.
+ * @param  frame_us: Time until the queued frame's table is replaced.
+ * @retval None
+ */
+void sticks_frame_sync(uint16_t frame_us) {
+	uint16_t guard = sync_guard_us;
+
+#if STICKS_OVERSAMPLE > 1
+	uint32_t now = DWT_CYCCNT;
+
+	sticks_scan_period((now - frame_stamp) / (SystemCoreClock / 1000000));
+	frame_stamp = now;
+#endif
+
+	sticks_arm((frame_us > guard) ? frame_us - guard : 0);
+}
+
+/**
+ * @brief  This function handles the TIM6 frame sync one-shot.
+ * @note   Takes the sticks for the mixer stage. Re-arms for a 20ms
+ *         free run in case the pulses stop calling sticks_frame_sync().
+ * @param  None
+ * @retval None
+ */
+void TIM6_DAC_IRQHandler(void) {
+	TIM6->SR = (uint16_t)~TIM_FLAG_Update;
+
+	// The pulse ISR may re-arm in between, don't undo that.
+	__disable_irq();
+	if (!(TIM6->CR1 & TIM_CR1_CEN))
+		sticks_arm(STICKS_FRAME_US);
+	__enable_irq();
+
+#if STICKS_OVERSAMPLE > 1
+	perf_trace(TRACE_SAMPLE);
+	sticks_decimate();
+
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#else
+	// The DMA completion pends the mixer stage.
+	ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+#endif
+}
+
+#if STICKS_OVERSAMPLE == 1
+/**
+ * @brief  This function handles the DMA end of transfer fro ADC read.
+ * @note   Takes a copy of the samples and hands over to PendSV, so the
+ *         higher priority level is held for as short as possible.
  * @param  None
  * @retval None
  */
 void DMA1_Channel1_IRQHandler(void) {
+	uint32_t perf = perf_start();
+	int i;
 
 	DMA_ClearFlag(DMA1_FLAG_TC1);
 	DMA_ClearITPendingBit(DMA_IT_TC);
 
+	for (i = 0; i < STICK_SCAN_CHANNELS; ++i)
+		adc_frame[i] = adc_data[i];
+	perf_trace(TRACE_SAMPLE);
+
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+
+	perf_record(PERF_ADC_DMA, perf);
+}
+#endif
+
+/**
+ * @brief  Mixer stage, pended by the frame sync (or single scan) completion.
+ * @note   Processes the ADC stick data then calls the mixer.
+ *         Runs at MIXER_IRQ_PRIORITY.
+ * @param  None
+ * @retval None
+ */
+void PendSV_Handler(void) {
+	uint32_t perf = perf_start();
+	uint32_t cycles;
+
 	// update the sticks data now
 	sticks_update();
 
 	// Don't run the mixer if we're calibrating
 	if (cal_state == CAL_OFF) {
+		sticks_filter();
+
 		if (!g_modelInvalid) {
 			// Run the mixer.
 			mixer_update();
@@ -308,4 +742,15 @@ void DMA1_Channel1_IRQHandler(void) {
 	{
 		cal_update();
 	}
+
+	// Track the run time (including pre-emption) with a slowly decaying
+	// peak and keep the frame sync that far plus a margin ahead.
+	cycles = DWT_CYCCNT - perf;
+	mixer_peak -= mixer_peak >> 6;
+	if (cycles > mixer_peak)
+		mixer_peak = cycles;
+	sync_guard_us = mixer_peak / (SystemCoreClock / 1000000)
+			+ STICKS_SYNC_MARGIN + STICKS_SCAN_US;
+
+	perf_record(PERF_MIXER, perf);
 }
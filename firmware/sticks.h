@@ -19,6 +19,7 @@
 #include "myeeprom.h"
 
 #define STICK_ADC_CHANNELS		7
+#define STICK_SCAN_CHANNELS		6	// Regular scan, the battery is injected
 #define STICK_INPUT_CHANNELS	6
 #define STICKS_TO_CALIBRATE		6
 #define STICKS_TO_TRIM			4
@@ -29,6 +30,50 @@
 #define RESXl   1024l
 #define RESKul  100ul
 
+// NVIC pre-emption priority of the sticks / mixer stage (PendSV).
+#ifndef MIXER_IRQ_PRIORITY
+#define MIXER_IRQ_PRIORITY		6
+#endif
+
+// ADC scans averaged per mixer frame (power of 2, 1..16), all held in
+// the DMA ring. 1 gives a single scan per frame.
+#ifndef STICKS_OVERSAMPLE
+#define STICKS_OVERSAMPLE		8
+#endif
+
+// Free run period of the mixer stage without a frame sync (us).
+#define STICKS_FRAME_US			20000
+
+// Time kept between the mixer stage finishing and the next output frame
+// being built, on top of the measured mixer run time (us).
+#ifndef STICKS_SYNC_MARGIN
+#define STICKS_SYNC_MARGIN		250
+#endif
+
+// Single scan conversion time, 7 x 252 ADC clocks at 12MHz (us).
+#if STICKS_OVERSAMPLE > 1
+#define STICKS_SCAN_US			0
+#else
+#define STICKS_SCAN_US			150
+#endif
+
+// Shortest oversampling scan period, a scan plus slack (us). Frames
+// shorter than STICKS_OVERSAMPLE of these average over a bit more.
+#define STICKS_SCAN_MIN_US		150
+
+// Battery samples (1 per second) in the moving average.
+#define BATT_AVG_LEN			32
+// Minutes of averaged voltage kept for the slope estimate.
+#define BATT_SLOPE_LEN			8
+// sticks_get_battery_minutes() when there is no estimate.
+#define BATT_MINUTES_UNKNOWN	0xFFFF
+
+// Fraction bits of the stick IIR filter state. The floored step leaves
+// the state up to 2^iir - 1 below a target approached from below, so
+// this must be at least the largest iir + 1 for the rounded output to
+// settle on the same value from either side.
+#define STICKS_IIR_FRAC			8
+
 typedef enum
 {
 	STICK_R_H = 0,
@@ -55,8 +100,13 @@ extern CAL_STATE cal_state;
 
 void sticks_init(void);
 void sticks_calibrate(CAL_STATE state);
+void sticks_cal_compile(void);
+void sticks_filter(void);
 int16_t sticks_get(STICK chan);
 int16_t sticks_get_percent(STICK chan);
 uint16_t sticks_get_battery(void);
+uint16_t sticks_get_battery_minutes(void);
+void sticks_frame_sync(uint16_t frame_us);
+uint16_t sticks_get_sync_guard(void);
 
 #endif // _STICKS_H
@@ -110,6 +110,14 @@ const char * const mix_src[MIX_SRCS_MAX] = {
 		"CH6",
 		"CH7",
 		"CH8",
+		"CH9",
+		"CH10",
+		"CH11",
+		"CH12",
+		"CH13",
+		"CH14",
+		"CH15",
+		"CH16",
 		// CHOUT_BASE
 };
 
@@ -199,6 +207,8 @@ const char * const msg[GUI_MSG_MAX] = {
 		"OK to preset all settings?",
 		"Preset\nInsert\nDelete\nCopy\nPaste",/*GUI_MSG_ROW_MENU*/
 		"OK to Enter Firmware Upgrade?",/*GUI_MSG_FW_UPGRADE*/
+		"Mixes loop through channels, one uses last frame.",/*GUI_MSG_MIX_CYCLE*/
+		"Protocol uses the serial port, console is off.",/*GUI_MSG_SERIAL_CONSOLE*/
 
 		// Headings (System)
 		"RADIO SETUP",
@@ -206,6 +216,7 @@ const char * const msg[GUI_MSG_MAX] = {
 		"VERSION",
 		"DIAGNOSTICS",
 		"ANALOG",
+		"STICK FILTER",
 		"CALIBRATION",
 
 		// Headings (Model)
@@ -215,6 +226,7 @@ const char * const msg[GUI_MSG_MAX] = {
 		"EXPO/DR",
 		"MIXER",
 		"LIMITS",
+		"FAILSAFE",
 		"CURVES",
 		"CUSTOM SWITCHES",
 		"SAFETY SWITCHES",
@@ -259,10 +271,23 @@ const char * const model_menu_list1[MOD_MENU_LIST1_LEN] = {
 		"Thro Trim",
 		"Thro Expo",
 		"Thrim Incr",
+		"Protocol",
 		"PPM Extd Lmts",
 		"PPM #Chanels",
 		"PPM Delay",
 		"PPM Ex Frm Wdth",
+		"PPM Adaptive",
+		"SBUS 7ms",
+		"CRSF Rate Hz",
+		"Rate Hz",
+		"Link LQ RSSI",
+		"Multi Proto",
+		"Multi Type",
+		"Multi RX Num",
+		"Multi Option",
+		"Multi Low Pwr",
+		"Multi Autobind",
+		"Multi Bind",
 		"Center Beep",
 };
 
@@ -286,6 +311,23 @@ const char * const mixer_edit_list1[MIXER_EDIT_LIST1_LEN] = {
 
 
 
+const char * const protocols[] = {
+		"PPM",
+		"PPM16",
+		"SBUS",
+		"CRSF",
+		"MULTI"
+};
+
+
+const char * const crsf_rates[] = {
+		"50",
+		"150",
+		"250",
+		"500"
+};
+
+
 const char * const timer_modes[] = {
 		"Off",
 		"Abs",
@@ -308,6 +350,12 @@ const char * const inverse_labels[] = {
 		"INV"
 };
 
+const char * const failsafe_modes[] = {
+		"Hold",
+		"Fixed",
+		"No Pulse"
+};
+
 
 // TODO: what are they?
 
@@ -21,9 +21,9 @@
 #define NUM_SWITCHES	4
 
 #define SYS_MENU_LIST1_LEN	22
-#define MOD_MENU_LIST1_LEN	13
+#define MOD_MENU_LIST1_LEN	26
 #define MIXER_EDIT_LIST1_LEN 13
-#define MIX_SRCS_MAX 29
+#define MIX_SRCS_MAX 37
 #define MIX_WARN_MAX 4
 #define MIX_CURVE_MAX 15
 #define EXPODR_MAX 7
@@ -42,6 +42,8 @@ typedef enum {
 	GUI_MSG_OK_TO_PRESET_ALL,
 	GUI_MSG_ROW_MENU,
 	GUI_MSG_FW_UPGRADE,
+	GUI_MSG_MIX_CYCLE,
+	GUI_MSG_SERIAL_CONSOLE,
 
 	// Headings (System Menu)
 	GUI_HDG_RADIO_SETUP,
@@ -49,6 +51,7 @@ typedef enum {
 	GUI_HDG_VERSION,
 	GUI_HDG_DIAG,
 	GUI_HDG_ANALOG,
+	GUI_HDG_FILTER,
 	GUI_HDG_CALIBRATION,
 
 	// Headings (Model Menu)
@@ -58,6 +61,7 @@ typedef enum {
 	GUI_HDG_EXPODR,
 	GUI_HDG_MIXER,
 	GUI_HDG_LIMITS,
+	GUI_HDG_FAILSAFE,
 	GUI_HDG_CURVES,
 	GUI_HDG_CUST_SW,
 	GUI_HDG_SAFE_SW,
@@ -74,6 +78,7 @@ enum _menu_page {
 	SYS_PAGE_VERSION,
 	SYS_PAGE_DIAG,
 	SYS_PAGE_ANA,
+	SYS_PAGE_FILTER,
 	SYS_PAGE_CAL,
 };
 
@@ -84,6 +89,7 @@ enum _model_page {
 	MOD_PAGE_EXPODR,
 	MOD_PAGE_MIXER,
 	MOD_PAGE_LIMITS,
+	MOD_PAGE_FAILSAFE,
 	MOD_PAGE_CURVES,
 	MOD_PAGE_CUST_SW,
 	MOD_PAGE_SAFE_SW,
@@ -132,8 +138,11 @@ extern const char * const system_menu_list1[SYS_MENU_LIST1_LEN];
 extern const char * const model_menu_list1[MOD_MENU_LIST1_LEN];
 extern const char * const mixer_edit_list1[MIXER_EDIT_LIST1_LEN];
 extern const char * const timer_modes[];
+extern const char * const protocols[];
+extern const char * const crsf_rates[];
 extern const char * const dir_labels[];
 extern const char * const inverse_labels[];
+extern const char * const failsafe_modes[];
 extern const char * const safety_switch_mode_labels[];
 
 #endif // _STRINGS_H
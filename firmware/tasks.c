@@ -22,6 +22,7 @@
 
 #include "system.h"
 #include "tasks.h"
+#include "perf.h"
 #include "string.h"
 
 static uint32_t tasks[TASK_END];
@@ -98,8 +99,11 @@ void task_process_all(void)
 		{
 			if (task_fn[task] != 0)
 			{
+				uint32_t perf = perf_start();
+
 				tasks[task] = 0;
 				task_fn[task](task_data[task]);
+				perf_record(PERF_TASK + task, perf);
 			}
 		}
 	}
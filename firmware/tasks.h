@@ -21,13 +21,21 @@
 
 #include <stdint.h>
 
+// Each task and its perf_dump() name, add new tasks here.
+#define TASK_LIST(X) \
+	X(TASK_PROCESS_KEYPAD,	"t_keys") \
+	X(TASK_PROCESS_STICKS,	"t_stick") \
+	X(TASK_PROCESS_GUI,		"t_gui") \
+	X(TASK_PROCESS_EEPROM,	"t_eepr") \
+	X(TASK_PROCESS_REMOTE,	"t_remot") \
+	X(TASK_PROCESS_BATTERY,	"t_batt") \
+	X(TASK_PROCESS_PULSES,	"t_puls")
+
+#define TASK_ENUM(id, name)	id,
+
 typedef enum
 {
-	TASK_PROCESS_KEYPAD,
-	TASK_PROCESS_STICKS,
-	TASK_PROCESS_GUI,
-	TASK_PROCESS_EEPROM,
-	TASK_PROCESS_REMOTE,
+	TASK_LIST(TASK_ENUM)
 	TASK_END
 } Tasks;
 
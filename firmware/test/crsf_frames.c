@@ -0,0 +1,148 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * CRSF: the CRC table against a bit at a time CRC8 (poly 0xD5), the
+ * RC_CHANNELS_PACKED frame pulses.c builds against a reference frame,
+ * and LINK_STATISTICS frames fed back a byte at a time into g_crsfLink,
+ * with line noise, bad CRCs, frames for other addresses and replies cut
+ * short.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_periph.h"
+#include "../pulses.c"
+#include "host.h"
+
+#define CRC_CASES		100000
+
+static uint32_t seed = 11;
+
+static int rnd(int lo, int hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (int)((seed >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+// All channels centred, as SBUS plus the header and CRC
+static const uint8_t crsf_centre[CRSF_FRAME_LEN] = {
+	0xEE, 0x18, 0x16, 0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81,
+	0x0F, 0x7C, 0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F,
+	0x7C, 0xAD,
+};
+
+// RSSI -64/-69dBm, LQ 100%, SNR -10dB, antenna 1, RF mode 2, power 3,
+// downlink -82dBm, 95%, 10dB
+static const uint8_t crsf_link_stats[CRSF_LINK_STATS_LEN + 4] = {
+	0xEA, 0x0C, 0x14, 0x40, 0x45, 0x64, 0xF6, 0x01, 0x02, 0x03, 0x52, 0x5F,
+	0x0A, 0xEB,
+};
+
+// The reference CRC, one bit at a time
+static uint8_t crc8_ref(const uint8_t *ptr, int len)
+{
+	uint8_t crc = 0;
+
+	while (len--) {
+		crc ^= *ptr++;
+		for (int i = 0; i < 8; ++i)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0xD5 : crc << 1;
+	}
+	return crc;
+}
+
+static void feed(const uint8_t *ptr, int len)
+{
+	while (len--)
+		crsf_rx_byte(*ptr++);
+}
+
+static void link_check(uint16_t frames, uint16_t errors)
+{
+	HOST_CHECK(g_crsfLink.frames == frames);
+	HOST_CHECK(g_crsfLink.errors == errors);
+	HOST_CHECK(g_crsfLink.uplinkRssi1 == 64);
+	HOST_CHECK(g_crsfLink.uplinkRssi2 == 69);
+	HOST_CHECK(g_crsfLink.uplinkLq == 100);
+	HOST_CHECK(g_crsfLink.uplinkSnr == -10);
+	HOST_CHECK(g_crsfLink.antenna == 1);
+	HOST_CHECK(g_crsfLink.rfMode == 2);
+	HOST_CHECK(g_crsfLink.txPower == 3);
+	HOST_CHECK(g_crsfLink.downlinkRssi == 82);
+	HOST_CHECK(g_crsfLink.downlinkLq == 95);
+	HOST_CHECK(g_crsfLink.downlinkSnr == 10);
+}
+
+int main(void)
+{
+	static PulseTable pt;
+	int16_t chans[NUM_CHNOUT];
+	uint8_t buf[CRSF_FRAME_MAX];
+
+	// CRC-8/DVB-S2 check value
+	HOST_CHECK(crsf_crc8((const uint8_t*)"123456789", 9) == 0xBC);
+	for (long c = 0; c < CRC_CASES; ++c) {
+		int len = rnd(0, CRSF_FRAME_MAX);
+
+		for (int i = 0; i < len; ++i)
+			buf[i] = rnd(0, 255);
+		HOST_CHECK(crsf_crc8(buf, len) == crc8_ref(buf, len));
+	}
+
+	// RC_CHANNELS_PACKED
+	memset(chans, 0, sizeof(chans));
+	pulses_build(&pt, PROTO_CRSF, (volatile int16_t*)chans);
+	HOST_CHECK(pt.serialLen == CRSF_FRAME_LEN);
+	HOST_CHECK(!pt.silent);
+	HOST_CHECK(memcmp(pt.serial, crsf_centre, CRSF_FRAME_LEN) == 0);
+	chans[5] = PULSES_NO_PULSE;
+	pulses_build(&pt, PROTO_CRSF, (volatile int16_t*)chans);
+	HOST_CHECK(pt.silent);
+
+	// LINK_STATISTICS, behind line noise and a frame for the module
+	crsf_rx_reset();
+	buf[0] = 0x00;
+	buf[1] = 0xFF;
+	feed(buf, 2);
+	feed(crsf_centre, CRSF_FRAME_LEN);
+	feed(crsf_link_stats, sizeof(crsf_link_stats));
+	link_check(1, 0);
+
+	// Bad CRC, counted and the last statistics kept
+	memcpy(buf, crsf_link_stats, sizeof(crsf_link_stats));
+	buf[5] = 0;
+	feed(buf, sizeof(crsf_link_stats));
+	link_check(1, 1);
+
+	// Impossible length, dropped at once
+	buf[0] = CRSF_ADDRESS_RADIO;
+	buf[1] = CRSF_FRAME_MAX;
+	feed(buf, 2);
+	feed(crsf_link_stats, sizeof(crsf_link_stats));
+	link_check(2, 1);
+
+	// A reply cut short by the next radio frame
+	feed(crsf_link_stats, 6);
+	crsf_rx_reset();
+	feed(crsf_link_stats, sizeof(crsf_link_stats));
+	link_check(3, 1);
+
+	printf("crsf: %d CRCs checked\n", CRC_CASES);
+	return host_result("crsf");
+}
@@ -0,0 +1,93 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Custom curve segment tables against the er9x interpolation they
+ * replaced, which is kept here as the reference. Every int16_t input,
+ * for alternating full scale points and for random curves, must give
+ * exactly the same value.
+ *
+ */
+
+#include <stdio.h>
+
+#include "../mixer.c"
+#include "host.h"
+
+#define CURVE_SETS		24
+
+// The er9x intpol(), -100, -75, -50, -25, 0, 25, 50, 75, 100
+static int16_t curve_ref(int16_t x, uint8_t idx)
+{
+#define D9 (RESX * 2 / 8)
+#define D5 (RESX * 2 / 4)
+    bool    cv9 = idx >= MAX_CURVE5;
+    int8_t *crv = cv9 ? g_model.curves9[idx-MAX_CURVE5] : g_model.curves5[idx];
+    int16_t erg;
+
+    x+=RESXu;
+    if(x < 0) {
+        erg = (int16_t)crv[0] * (RESX/4);
+    } else if(x >= (RESX*2)) {
+        erg = (int16_t)crv[(cv9 ? 8 : 4)] * (RESX/4);
+    } else {
+        int16_t a,dx;
+        if(cv9){
+            a   = (uint16_t)x / D9;
+            dx  =((uint16_t)x % D9) * 2;
+        } else {
+            a   = (uint16_t)x / D5;
+            dx  = (uint16_t)x % D5;
+        }
+        erg  = (int16_t)crv[a]*((D5-dx)/2) + (int16_t)crv[a+1]*(dx/2);
+    }
+    return erg / 25; // 100*D5/RESX;
+}
+
+static uint32_t seed = 1;
+
+static int8_t curve_point(int set, int k)
+{
+	if (set < 2)
+		return ((set ^ k) & 1) ? 100 : -100;
+	seed = seed * 1103515245u + 12345u;
+	return (int8_t)((seed >> 16) % 201) - 100;
+}
+
+int main(void)
+{
+	long checked = 0;
+
+	for (int set = 0; set < CURVE_SETS; ++set) {
+		for (int c = 0; c < MAX_CURVE5; ++c)
+			for (int k = 0; k < 5; ++k)
+				g_model.curves5[c][k] = curve_point(set, k);
+		for (int c = 0; c < MAX_CURVE9; ++c)
+			for (int k = 0; k < 9; ++k)
+				g_model.curves9[c][k] = curve_point(set, k);
+		curve_compile();
+
+		for (int idx = 0; idx < MAX_CURVE5 + MAX_CURVE9; ++idx) {
+			for (int x = INT16_MIN; x <= INT16_MAX; ++x) {
+				HOST_CHECK(curve_custom(x, idx) == curve_ref(x, idx));
+				checked++;
+			}
+		}
+	}
+
+	printf("curves: %ld points checked\n", checked);
+	return host_result("curves");
+}
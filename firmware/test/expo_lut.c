@@ -0,0 +1,73 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Expo lookup tables against expo(), for every expo value and every
+ * input: within 1 LSB over -RESX..RESX, exact outside it and for the
+ * values that did not get a table.
+ *
+ */
+
+#include <stdio.h>
+
+#include "../mixer.c"
+#include "host.h"
+
+static int worst;
+
+static void expo_check(int8_t k, uint8_t idx)
+{
+	for (int x = -1500; x <= 1500; ++x) {
+		int e = expo_lookup(x, idx, k) - expo(x, k);
+
+		e = (e < 0) ? -e : e;
+		if (e > worst)
+			worst = e;
+		if (x < -RESX || x > RESX || idx == EXPO_LUT_NONE)
+			HOST_CHECK(e == 0);
+		else
+			HOST_CHECK(e <= 1);
+	}
+}
+
+int main(void)
+{
+	volatile ExpoData *ed = &g_model.expoData[0];
+
+	for (int k = -100; k <= 100; ++k) {
+		memset((void*)&g_model, 0, sizeof(g_model));
+		ed->expo[DR_HIGH][DR_EXPO][DR_RIGHT] = k;
+		expo_compile();
+		HOST_CHECK((k == 0) == (expo_lut_map[0][DR_HIGH][DR_RIGHT] == EXPO_LUT_NONE));
+		expo_check(k, expo_lut_map[0][DR_HIGH][DR_RIGHT]);
+	}
+
+	// Equal values share a table, the pool overflows to expo()
+	memset((void*)&g_model, 0, sizeof(g_model));
+	for (int i = 0; i < STICKS_TO_TRIM; ++i) {
+		g_model.expoData[i].expo[DR_HIGH][DR_EXPO][DR_RIGHT] = 10 + i;
+		g_model.expoData[i].expo[DR_HIGH][DR_EXPO][DR_LEFT] = 10 + i;
+	}
+	g_model.expoData[3].expo[DR_LOW][DR_EXPO][DR_LEFT] = -50;
+	expo_compile();
+	for (int i = 0; i < STICKS_TO_TRIM; ++i)
+		HOST_CHECK(expo_lut_map[i][DR_HIGH][DR_RIGHT] == expo_lut_map[i][DR_HIGH][DR_LEFT]);
+	HOST_CHECK(expo_lut_map[3][DR_LOW][DR_LEFT] == EXPO_LUT_NONE);
+	expo_check(-50, expo_lut_map[3][DR_LOW][DR_LEFT]);
+
+	printf("expo_lut: worst error %d LSB\n", worst);
+	return host_result("expo_lut");
+}
@@ -0,0 +1,148 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Stick filter stage.
+ *
+ * IIR: every time constant settles on the input from above and below,
+ * and on a noisy stick held still and then stepped, the jitter goes
+ * down and the 90% step lag stays near 2.3 * 2^iir frames.
+ * Deadband: the band reads 0 and the full throw is kept.
+ * Hysteresis: small moves are held, the centre always comes back.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../sticks.c"
+#include "host.h"
+
+#define FILTER_HOLD		2000	// Frames held still for the jitter
+#define FILTER_NOISE	6		// +/- ADC noise in RESX units
+#define FILTER_STEP		600		// Step for the lag
+
+static uint32_t seed = 7;
+
+static int noise(int span)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (int)((seed >> 16) % (2 * span + 1)) - span;
+}
+
+static void filter_set(uint8_t iir, uint8_t deadband, uint8_t hysteresis)
+{
+	volatile StickFilter *f = &g_eeGeneral.stickFilter[0];
+
+	f->iir = iir;
+	f->deadband = deadband;
+	f->hysteresis = hysteresis;
+	memset(stick_filter, 0, sizeof(stick_filter));
+}
+
+static int16_t filter_run(int16_t x)
+{
+	stick_data[0] = x;
+	sticks_filter();
+	return stick_data[0];
+}
+
+// Settle on target from start, no noise
+static int16_t filter_settle(uint8_t iir, int16_t start, int16_t target)
+{
+	int16_t y = 0;
+
+	filter_set(0, 0, 0);
+	filter_run(start);
+	g_eeGeneral.stickFilter[0].iir = iir;
+	for (int i = 0; i < 64 << iir; ++i)
+		y = filter_run(target);
+	return y;
+}
+
+static void filter_iir(void)
+{
+	printf("iir  jitter(rms)  mean error  90%% lag(frames)\n");
+	for (uint8_t iir = 0; iir <= 7; ++iir) {
+		double sum = 0, sum2 = 0;
+		int lag = -1;
+
+		// From either side, near and far
+		for (int t = -RESX; t <= RESX; t += 37) {
+			HOST_CHECK(filter_settle(iir, t - 1, t) == t);
+			HOST_CHECK(filter_settle(iir, t + 1, t) == t);
+			HOST_CHECK(filter_settle(iir, -RESX, t) == t);
+			HOST_CHECK(filter_settle(iir, RESX, t) == t);
+		}
+
+		// Held still with noise, then a step
+		filter_set(iir, 0, 0);
+		for (int i = 0; i < 64 << iir; ++i)
+			filter_run(100 + noise(FILTER_NOISE));
+		for (int i = 0; i < FILTER_HOLD; ++i) {
+			int e = filter_run(100 + noise(FILTER_NOISE)) - 100;
+
+			sum += e;
+			sum2 += e * e;
+		}
+		for (int i = 0; lag < 0 && i < 64 << iir; ++i)
+			if (filter_run(100 + FILTER_STEP + noise(FILTER_NOISE)) >= 100 + FILTER_STEP * 9 / 10)
+				lag = i + 1;
+
+		sum /= FILTER_HOLD;
+		sum2 = sum2 / FILTER_HOLD - sum * sum;
+		printf("%3d  %11.2f  %10.2f  %15d\n", iir, sum2 > 0 ? sqrt(sum2) : 0, sum, lag);
+
+		// Unbiased, and the lag is close to ln(10) time constants
+		HOST_CHECK(sum > -0.5 && sum < 0.5);
+		HOST_CHECK(lag >= 1 && lag <= (iir ? 3 << iir : 1));
+		if (iir >= 2)
+			HOST_CHECK(sum2 < FILTER_NOISE * FILTER_NOISE / 3.0 / 2);
+	}
+}
+
+static void filter_deadband(void)
+{
+	filter_set(0, 40, 0);
+	for (int x = -40; x <= 40; ++x)
+		HOST_CHECK(filter_run(x) == 0);
+	HOST_CHECK(filter_run(41) >= 0 && filter_run(41) <= 2);
+	HOST_CHECK(filter_run(-41) <= 0 && filter_run(-41) >= -2);
+	HOST_CHECK(filter_run(RESX) >= RESX - 1 && filter_run(RESX) <= RESX);
+	HOST_CHECK(filter_run(-RESX) <= -RESX + 1 && filter_run(-RESX) >= -RESX);
+	for (int x = 41; x < RESX; ++x)
+		HOST_CHECK(filter_run(x) <= filter_run(x + 1));
+}
+
+static void filter_hysteresis(void)
+{
+	filter_set(0, 0, 8);
+	HOST_CHECK(filter_run(500) == 500);
+	HOST_CHECK(filter_run(505) == 500);
+	HOST_CHECK(filter_run(492) == 500);
+	HOST_CHECK(filter_run(509) == 509);
+	HOST_CHECK(filter_run(3) == 3);
+	HOST_CHECK(filter_run(0) == 0);
+}
+
+int main(void)
+{
+	filter_iir();
+	filter_deadband();
+	filter_hysteresis();
+	return host_result("filter");
+}
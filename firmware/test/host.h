@@ -0,0 +1,31 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+#ifndef _HOST_H
+#define _HOST_H
+
+#include <stdint.h>
+
+// Switch bitmask (SWITCH_SWx) returned by the keypad stubs.
+extern uint8_t host_switches;
+
+// Test helpers, see stubs.c
+int host_fail(const char *file, int line, const char *what);
+int host_result(const char *name);
+uint64_t host_ns(void);
+
+#define HOST_CHECK(c)	((c) ? 0 : host_fail(__FILE__, __LINE__, #c))
+
+#endif // _HOST_H
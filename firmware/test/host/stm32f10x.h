@@ -0,0 +1,36 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Host stand-in for the device header, found first on the include path
+ * of the host tests. The register definitions are the real ones, only
+ * the Cortex-M3 interrupt mask intrinsics become no-ops.
+ *
+ */
+
+#ifndef _HOST_STM32F10X_H
+#define _HOST_STM32F10X_H
+
+#define __enable_irq	__cm3_enable_irq
+#define __disable_irq	__cm3_disable_irq
+#include "../../system/stm32f10x.h"
+#undef __enable_irq
+#undef __disable_irq
+
+static inline void __enable_irq(void) {}
+static inline void __disable_irq(void) {}
+
+#endif // _HOST_STM32F10X_H
@@ -0,0 +1,61 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Include before a driver .c file to run it on the host. The timers,
+ * DMA channels, GPIOA and USART1 it uses become plain structs the test
+ * can set and read, and the DWT cycle counter reads host_cyccnt.
+ * Don't call the init functions, the library calls in them still
+ * touch the real addresses.
+ *
+ */
+
+#ifndef _HOST_PERIPH_H
+#define _HOST_PERIPH_H
+
+#include "stm32f10x.h"
+#include "perf.h"
+
+static TIM_TypeDef host_tim2, host_tim3;
+static DMA_TypeDef host_dma1;
+static DMA_Channel_TypeDef host_dma1_ch[8];	// Channel n at [n]
+static GPIO_TypeDef host_gpioa;
+static USART_TypeDef host_usart1;
+static uint32_t host_cyccnt;
+
+#undef TIM2
+#undef TIM3
+#undef DMA1
+#undef DMA1_Channel2
+#undef DMA1_Channel3
+#undef DMA1_Channel4
+#undef DMA1_Channel5
+#undef GPIOA
+#undef USART1
+#undef DWT_CYCCNT
+
+#define TIM2			(&host_tim2)
+#define TIM3			(&host_tim3)
+#define DMA1			(&host_dma1)
+#define DMA1_Channel2	(&host_dma1_ch[2])
+#define DMA1_Channel3	(&host_dma1_ch[3])
+#define DMA1_Channel4	(&host_dma1_ch[4])
+#define DMA1_Channel5	(&host_dma1_ch[5])
+#define GPIOA			(&host_gpioa)
+#define USART1			(&host_usart1)
+#define DWT_CYCCNT		host_cyccnt
+
+#endif // _HOST_PERIPH_H
@@ -0,0 +1,134 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Compiled output limits against the er9x limit code they replaced,
+ * which is kept here as the reference. Every LimitData the model menu
+ * can set (offset -1000..1000, min and max -100..100, reverse) is run
+ * with a zero, an end point and a random mixer sum. Every safety
+ * switch setting is run against every switch state.
+ *
+ */
+
+#include <stdio.h>
+
+#include "../mixer.c"
+#include "host.h"
+
+#define LIMIT_SUMS	3
+
+// The er9x output stage, from the mixer sum to the channel value
+static int16_t limit_ref(LimitData *ld, SafetySwData *ss, int32_t q)
+{
+        int16_t ofs = ld->offset;
+        int16_t lim_p = 10*(ld->max);
+        int16_t lim_n = 10*(ld->min);
+        if(ofs>lim_p) ofs = lim_p;
+        if(ofs<lim_n) ofs = lim_n;
+
+        if(q) q = (q>0) ?
+                    q*((int32_t)lim_p-ofs)/100000 :
+                    -q*((int32_t)lim_n-ofs)/100000 ;
+
+        q += calc1000toRESX(ofs);
+        lim_p = calc1000toRESX(lim_p);
+        lim_n = calc1000toRESX(lim_n);
+        if(q>lim_p) q = lim_p;
+        if(q<lim_n) q = lim_n;
+        if(ld->reverse) q=-q;
+
+        if(ss->opt.ss.swtch)
+            if(keypad_get_switch(1<<(ss->opt.ss.swtch-1)))
+            	q = calc100toRESX(ss->opt.ss.val);
+        return q;
+}
+
+static uint32_t seed = 1;
+
+// Zero, an end point, a random sum. Up to 4 full scale mixes at 125%.
+static int32_t limit_sum(int k)
+{
+	seed = seed * 1103515245u + 12345u;
+	if (k == 0)
+		return 0;
+	if (k == 1)
+		return (seed & 0x10000) ? 512000 : -512000;
+	return (int32_t)((seed >> 8) % 1024001) - 512000;
+}
+
+int main(void)
+{
+	LimitData ld[NUM_CHNOUT];
+	SafetySwData ss[NUM_CHNOUT];
+	long checked = 0;
+
+	memset(ss, 0, sizeof(ss));
+
+	// Every menu setting, 16 offsets per compile, one per channel
+	for (int min = -100; min <= 100; ++min) {
+		for (int max = -100; max <= 100; ++max) {
+			for (int rev = 0; rev < 2; ++rev) {
+				for (int ofs = -1000; ofs <= 1000; ofs += NUM_CHNOUT) {
+					for (int i = 0; i < NUM_CHNOUT; ++i) {
+						volatile LimitData *ld = &g_model.limitData[i];
+
+						ld->min = min;
+						ld->max = max;
+						ld->reverse = rev;
+						ld->offset = (ofs + i > 1000) ? 1000 : ofs + i;
+					}
+					limit_compile();
+					memcpy(ld, (void*)g_model.limitData, sizeof(ld));
+					for (int i = 0; i < NUM_CHNOUT; ++i) {
+						for (int k = 0; k < LIMIT_SUMS; ++k) {
+							int32_t q = limit_sum(k);
+
+							HOST_CHECK(limit_apply(&chan_limits[i], q)
+									== limit_ref(&ld[i], &ss[i], q));
+							checked++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Every safety switch and value against every switch state
+	memset((void*)&g_model, 0, sizeof(g_model));
+	for (int sw = 0; sw < 32; ++sw) {
+		for (int val = -100; val <= 100; ++val) {
+			g_model.safetySw[0].opt.ss.swtch = sw;
+			g_model.safetySw[0].opt.ss.val = val;
+			g_model.limitData[0].min = -100;
+			g_model.limitData[0].max = 100;
+			limit_compile();
+			memcpy(ld, (void*)g_model.limitData, sizeof(ld));
+			memcpy(ss, (void*)g_model.safetySw, sizeof(ss));
+			for (host_switches = 0; host_switches < 16; ++host_switches) {
+				for (int k = 0; k < LIMIT_SUMS; ++k) {
+					int32_t q = limit_sum(k);
+
+					HOST_CHECK(limit_apply(&chan_limits[0], q)
+							== limit_ref(&ld[0], &ss[0], q));
+					checked++;
+				}
+			}
+		}
+	}
+
+	printf("limits: %ld sums checked\n", checked);
+	return host_result("limits");
+}
@@ -0,0 +1,262 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Reference models for the mixer replay: a plane, a delta and a 120
+ * degree CCPM heli. Between them they use sticks and pots, MAX, the
+ * CYC inputs, chained channels, all multiplex modes, switched mixes,
+ * delay and slow, the curve functions, 5 and 9 point curves, expo and
+ * dual rates, trims, throttle trim, limits with offset and reverse,
+ * and a safety switch.
+ *
+ * The field names used here exist in every revision of ModelData,
+ * so the same models can be replayed through older mixers.
+ *
+ */
+
+#include <string.h>
+
+#include "system.h"
+#include "myeeprom.h"
+#include "art6.h"
+#include "sticks.h"
+#include "keypad.h"
+#include "models.h"
+
+static uint8_t mix_count;
+
+static void model_clear(void)
+{
+	memset((void*)&g_model, 0, sizeof(g_model));
+	for (int i = 0; i < NUM_CHNOUT; ++i) {
+		g_model.limitData[i].min = -100;
+		g_model.limitData[i].max = 100;
+	}
+	mix_count = 0;
+}
+
+static volatile MixData *model_mix(uint8_t ch, uint8_t src, int8_t weight)
+{
+	volatile MixData *md = &g_model.mixData[mix_count++];
+
+	md->destCh = ch;
+	md->srcRaw = src;
+	md->weight = weight;
+	return md;
+}
+
+static void model_expo(uint8_t stick, int8_t expo, int8_t weight, int8_t drSw)
+{
+	volatile ExpoData *ed = &g_model.expoData[stick];
+
+	// High rate plain, the switch selects expo and less throw
+	for (int dr = DR_MID; dr <= DR_LOW; ++dr) {
+		ed->expo[dr][DR_EXPO][DR_RIGHT] = expo;
+		ed->expo[dr][DR_EXPO][DR_LEFT] = expo;
+		ed->expo[dr][DR_WEIGHT][DR_RIGHT] = weight;
+		ed->expo[dr][DR_WEIGHT][DR_LEFT] = weight;
+	}
+	ed->drSw1 = drSw;
+}
+
+/**
+ * @brief  Radio settings shared by all the models.
+ * @note   Stick mode 0: RUD, ELE, THR, AIL are srcRaw 1-4.
+ * @param  None
+ * @retval None
+ */
+void models_general(void)
+{
+	memset((void*)&g_eeGeneral, 0, sizeof(g_eeGeneral));
+	for (int i = 0; i < STICK_ADC_CHANNELS; ++i) {
+		g_eeGeneral.calData[i].min = MODELS_ADC_MIN;
+		g_eeGeneral.calData[i].centre = MODELS_ADC_CENTRE;
+		g_eeGeneral.calData[i].max = MODELS_ADC_MAX;
+	}
+	// Slightly off centre, the two halves scale differently
+	g_eeGeneral.calData[STICK_R_H].centre = MODELS_ADC_CENTRE + 37;
+	g_eeGeneral.calData[STICK_L_V].min = MODELS_ADC_MIN + 90;
+}
+
+static void model_plane(void)
+{
+	static const int8_t diff[5] = { -100, -60, 0, 40, 80 };
+	static const int8_t thr[9] = { -100, -70, -45, -20, 0, 20, 45, 75, 100 };
+	volatile MixData *md;
+
+	model_clear();
+	memcpy((void*)g_model.curves5[0], diff, sizeof(diff));
+	memcpy((void*)g_model.curves9[1], thr, sizeof(thr));
+
+	model_mix(1, 4, 100);								// AIL
+	model_mix(2, 2, 100);								// ELE
+	md = model_mix(3, 3, 100);							// THR, curve
+	md->curve = 12;
+	model_mix(4, 1, 100);								// RUD
+	md = model_mix(4, 4, 30);							// AIL > RUD on SWB
+	md->swtch = SWITCH_SWB;
+	md = model_mix(5, 4, -100);							// Second aileron
+	md->curve = 7;
+	md = model_mix(6, 5, 50);							// Flaps on VRA, slow
+	md->speedUp = 3;
+	md->speedDown = 2;
+	md = model_mix(6, CHOUT_BASE + 1, 40);				// + CH1 (flaperon)
+	md->sOffset = -10;
+	md = model_mix(7, MIX_MAX, 100);					// Gear on SWC, delayed
+	md->swtch = SWITCH_SWC;
+	md->delayUp = 2;
+	md->delayDown = 1;
+	md = model_mix(8, 6, 100);							// VRB ...
+	md->mltpx = MLTPX_REP;
+	md = model_mix(8, 3, 100);							// ... times THR
+	md->mltpx = MLTPX_MUL;
+	md->curve = 1;
+
+	model_expo(3, 30, -20, SWITCH_SWA);
+	model_expo(1, 20, -10, SWITCH_SWA);
+	g_model.trim[0] = 7;
+	g_model.trim[1] = -12;
+	g_model.trim[2] = -30;
+	g_model.trim[3] = 3;
+	g_model.thrTrim = 1;
+
+	g_model.limitData[0].min = -90;
+	g_model.limitData[0].max = 110;
+	g_model.limitData[1].reverse = 1;
+	g_model.limitData[2].offset = -50;
+	g_model.limitData[4].offset = 120;
+	g_model.limitData[4].reverse = 1;
+	g_model.safetySw[2].opt.ss.swtch = 4;				// SWD cuts the throttle
+	g_model.safetySw[2].opt.ss.val = -100;
+}
+
+static void model_delta(void)
+{
+	static const int8_t pos[5] = { 0, 10, 35, 70, 100 };
+	volatile MixData *md;
+
+	model_clear();
+	memcpy((void*)g_model.curves5[1], pos, sizeof(pos));
+
+	model_mix(1, 4, 60);								// Left elevon
+	md = model_mix(1, 2, 60);
+	md->carryTrim = 1;
+	model_mix(2, 4, -60);								// Right elevon
+	model_mix(2, 2, 60);
+	md = model_mix(3, 3, 100);							// THR, expo below
+	md->curve = 8;
+	md = model_mix(4, 1, 100);							// RUD, positive only
+	md->curve = 1;
+	md = model_mix(4, 1, 50);							// and negative half
+	md->curve = 2;
+	md = model_mix(5, CHOUT_BASE + 1, 50);				// CH1 + CH2 / 2
+	md->mltpx = MLTPX_ADD;
+	model_mix(5, CHOUT_BASE + 2, 50);
+	md = model_mix(6, MIX_FULL, 100);					// Switched, slow
+	md->swtch = SWITCH_SWB;
+	md->speedUp = 5;
+	md->speedDown = 5;
+	md = model_mix(7, 5, 80);							// VRA, x>0, |x|
+	md->curve = 3;
+	md = model_mix(7, 6, 40);
+	md->curve = 5;
+
+	model_expo(1, 40, 0, SWITCH_SWA);
+	model_expo(3, 40, -30, SWITCH_SWA);
+	g_model.expoData[1].drSw2 = SWITCH_SWC;
+	g_model.expoData[1].expo[DR_LOW][DR_EXPO][DR_RIGHT] = 60;
+	g_model.expoData[1].expo[DR_LOW][DR_EXPO][DR_LEFT] = 60;
+	g_model.expoData[1].expo[DR_LOW][DR_WEIGHT][DR_RIGHT] = -50;
+	g_model.expoData[1].expo[DR_LOW][DR_WEIGHT][DR_LEFT] = -50;
+	g_model.trim[1] = 20;
+	g_model.trim[3] = -15;
+
+	g_model.limitData[0].min = -80;
+	g_model.limitData[0].max = 80;
+	g_model.limitData[1].min = -80;
+	g_model.limitData[1].max = 80;
+	g_model.limitData[1].reverse = 1;
+	g_model.limitData[3].offset = 300;
+}
+
+static void model_heli120(void)
+{
+	static const int8_t thr_normal[5] = { -100, 20, 40, 70, 100 };
+	static const int8_t thr_idle[5] = { 60, 40, 30, 60, 100 };
+	static const int8_t pitch[9] = { -80, -60, -40, -20, 0, 25, 50, 75, 100 };
+	volatile MixData *md;
+
+	model_clear();
+	memcpy((void*)g_model.curves5[2], thr_normal, sizeof(thr_normal));
+	memcpy((void*)g_model.curves5[3], thr_idle, sizeof(thr_idle));
+	memcpy((void*)g_model.curves9[0], pitch, sizeof(pitch));
+
+	g_model.swashType = SWASH_TYPE_120;
+	g_model.swashCollectiveSource = CHOUT_BASE + 7;		// Pitch curve on CH7
+	g_model.swashRingValue = 90;
+	g_model.swashInvertELE = 1;
+
+	md = model_mix(1, MIX_CYC1, 100);
+	md = model_mix(2, MIX_CYC2, 100);
+	md = model_mix(3, 3, 100);							// Normal throttle
+	md->curve = 9;
+	md = model_mix(3, 3, 100);							// Idle up on SWA
+	md->curve = 10;
+	md->mltpx = MLTPX_REP;
+	md->swtch = SWITCH_SWA;
+	model_mix(4, 1, 100);								// RUD
+	md = model_mix(4, 3, -15);							// Revo mix
+	md->curve = 4;
+	md = model_mix(5, MIX_MAX, 50);						// Gyro gain, SWB
+	md->swtch = SWITCH_SWB;
+	md->mltpx = MLTPX_REP;
+	model_mix(6, MIX_CYC3, 100);
+	md = model_mix(7, 3, 100);							// Pitch
+	md->curve = 11;
+	md->carryTrim = 1;
+
+	model_expo(0, 25, -15, SWITCH_SWD);
+	model_expo(1, 25, -15, SWITCH_SWD);
+	model_expo(3, 25, -15, SWITCH_SWD);
+	g_model.trim[1] = -4;
+	g_model.trim[3] = 9;
+
+	g_model.limitData[0].offset = -35;
+	g_model.limitData[1].offset = 60;
+	g_model.limitData[5].reverse = 1;
+	g_model.limitData[5].min = -95;
+	g_model.limitData[5].max = 95;
+	g_model.safetySw[2].opt.ss.swtch = 3;				// SWC throttle hold
+	g_model.safetySw[2].opt.ss.val = -80;
+}
+
+/**
+ * @brief  Load a reference model into g_model.
+ * @param  name: "plane", "delta" or "heli120".
+ * @retval 0 on success, -1 for an unknown name.
+ */
+int models_load(const char *name)
+{
+	if (strcmp(name, "plane") == 0)
+		model_plane();
+	else if (strcmp(name, "delta") == 0)
+		model_delta();
+	else if (strcmp(name, "heli120") == 0)
+		model_heli120();
+	else
+		return -1;
+	return 0;
+}
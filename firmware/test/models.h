@@ -0,0 +1,27 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+#ifndef _MODELS_H
+#define _MODELS_H
+
+// Raw ADC calibration used by all the test models.
+#define MODELS_ADC_MIN		210
+#define MODELS_ADC_CENTRE	2050
+#define MODELS_ADC_MAX		3890
+
+void models_general(void);
+int models_load(const char *name);
+
+#endif // _MODELS_H
@@ -0,0 +1,172 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * PPM and PPM16 pulse tables, for random channel frames and every
+ * setting of the model menu.
+ *
+ * Each stream is decoded from its durations: channel pulses followed by
+ * stop pulses, edge to edge widths of 1500us +/- the range, the sync
+ * gap, and both streams the same frame length. Each stream is then
+ * looped back through the trainer decoder as the capture would see it,
+ * and the decoded g_ppmIns must equal the widths.
+ *
+ */
+
+#include <stdio.h>
+
+#include "host_periph.h"
+#include "../pulses.c"
+#include "host.h"
+
+#define PPM16_CASES		200000
+
+static uint32_t seed = 3;
+static uint8_t ring_head;
+
+static int rnd(int lo, int hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (int)((seed >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+// Edge to edge width of a channel (us)
+static uint16_t ppm_width(int16_t v)
+{
+	int32_t range = g_model.extendedLimits ? PPM_LIMIT_EXTENDED : PPM_LIMIT_NORMAL;
+	int32_t w = ((int32_t)v * range + RESX / 2) / RESX;
+
+	if (w > range)
+		w = range;
+	if (w < -range)
+		w = -range;
+	w += PPM_CENTER;
+	return (w < 2 * PPM_STOP_LEN) ? 2 * PPM_STOP_LEN : w;
+}
+
+// Decode one stream, returns its frame length (us)
+static uint32_t ppm_decode(const uint16_t *w, uint8_t count, const int16_t *chans, uint8_t n)
+{
+	uint32_t len = 0;
+
+	if (HOST_CHECK(count == 2 * n + 2))
+		return 0;
+	for (uint8_t i = 0; i < n; ++i) {
+		HOST_CHECK(w[2 * i + 1] == PPM_STOP_LEN);
+		HOST_CHECK(w[2 * i] + w[2 * i + 1] == ppm_width(chans[i]));
+		len += w[2 * i] + w[2 * i + 1];
+	}
+	HOST_CHECK(w[2 * n + 1] == PPM_STOP_LEN);
+	HOST_CHECK(w[2 * n] >= (g_model.ppmAdaptive ? PPM_ADAPTIVE_GAP_LEN : PPM_MIN_GAP_LEN));
+	return len + w[2 * n] + w[2 * n + 1];
+}
+
+// Play a stream into the trainer capture ring, edge to edge
+static void ppm_loop(const uint16_t *w, uint8_t count, uint32_t len)
+{
+	for (uint8_t i = 0; i < count; i += 2) {
+		ppm_in_ring[ring_head] = w[i] + w[i + 1];
+		ring_head = (ring_head + 1) % PPM_IN_RING_LEN;
+	}
+	DMA1_Channel3->CNDTR = PPM_IN_RING_LEN - ring_head;
+	pulses_trainer_decode(len);
+}
+
+static void ppm_loop_check(const uint16_t *w, uint8_t count, uint32_t len,
+		const int16_t *chans, uint8_t n)
+{
+	int f;
+
+	ppmInValid = 0;
+	ppmInState = 0;
+	for (f = 0; f < 3; ++f)
+		ppm_loop(w, count, len);
+
+	if (n < PPM_IN_MIN_CHANNELS) {
+		HOST_CHECK(!ppmInValid);
+		return;
+	}
+	HOST_CHECK(ppmInValid);
+	for (uint8_t i = 0; i < NUM_PPM; ++i)
+		HOST_CHECK(g_ppmIns[i] == ((i < n) ? ppm_width(chans[i]) - PPM_CENTER : 0));
+
+	// Lost once PPM_IN_TIMEOUT worth of frames had no trainer frame.
+	for (f = 0; ppmInValid && f < 1000; ++f)
+		pulses_trainer_decode(len);
+	HOST_CHECK(f == (PPM_IN_TIMEOUT + len - 1) / len);
+	for (uint8_t i = 0; i < NUM_PPM; ++i)
+		HOST_CHECK(g_ppmIns[i] == 0);
+}
+
+int main(void)
+{
+	static PulseTable pt;
+	int16_t chans[NUM_CHNOUT];
+	long streams = 0;
+
+	DMA1_Channel3->CNDTR = PPM_IN_RING_LEN;
+	for (int c = 0; c < PPM16_CASES; ++c) {
+		uint8_t proto = (c & 1) ? PROTO_PPM16 : PROTO_PPM;
+		uint8_t start, n, trn;
+		uint32_t len, trnLen;
+
+		g_model.ppmStart = rnd(0, 7);
+		g_model.ppmNCH = rnd(1, NUM_PPM_CHNOUT);
+		g_model.ppmDelay = rnd(0, 7);
+		g_model.ppmFrameLength = rnd(0, 127);
+		g_model.ppmAdaptive = rnd(0, 1);
+		g_model.extendedLimits = rnd(0, 1);
+		g_model.pulsePol = rnd(0, 1);
+		for (int i = 0; i < NUM_CHNOUT; ++i)
+			chans[i] = (rnd(0, 9) == 0) ? rnd(-1500, 1500) : rnd(-RESX, RESX);
+
+		start = g_model.ppmStart;
+		n = g_model.ppmNCH;
+		if (start + n > NUM_CHNOUT)
+			n = NUM_CHNOUT - start;
+		trn = (start + NUM_PPM_CHNOUT + n > NUM_CHNOUT) ? NUM_CHNOUT - start - NUM_PPM_CHNOUT : n;
+
+		pulses_build(&pt, proto, (volatile int16_t*)chans);
+		HOST_CHECK(!pt.silent);
+		HOST_CHECK(pt.serialLen == 0);
+
+		// PPM-OUT
+		len = ppm_decode(pt.pword, pt.count, &chans[start], n);
+		HOST_CHECK(len == pt.len);
+		HOST_CHECK(len <= PPM_MAX_FRAME_LEN + PPM_STOP_LEN);
+		if (!g_model.ppmAdaptive)
+			HOST_CHECK(len >= PPM_MIN_FRAME_LEN + PPM_STOP_LEN
+					&& (len >= g_model.ppmFrameLength * 1000 + PPM_STOP_LEN
+						|| len == PPM_MAX_FRAME_LEN + PPM_STOP_LEN));
+		ppm_loop_check(pt.pword, pt.count, len, &chans[start], n);
+		streams++;
+
+		// Trainer port, PPM16 only
+		if (proto == PROTO_PPM) {
+			HOST_CHECK(pt.trnCount == 0);
+			continue;
+		}
+		trnLen = ppm_decode(&pt.pword[PULSES_STREAM_SIZE], pt.trnCount,
+				&chans[start + NUM_PPM_CHNOUT], trn);
+		HOST_CHECK(trnLen == len);
+		ppm_loop_check(&pt.pword[PULSES_STREAM_SIZE], pt.trnCount, len,
+				&chans[start + NUM_PPM_CHNOUT], trn);
+		streams++;
+	}
+
+	printf("ppm16: %ld streams decoded\n", streams);
+	return host_result("ppm16");
+}
@@ -0,0 +1,148 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Mixer trace replay.
+ *
+ * usage: replay <model> <trace> [repeats]
+ *
+ * Each trace line is one mixer frame:
+ *   <ms since last frame> <6 raw ADC scan channels> <switch mask>
+ * and goes through the same stages as PendSV_Handler(): calibration
+ * scaling, the stick filter and mixer_update(). g_chans is printed
+ * after every frame, so the output can be compared with a golden copy.
+ *
+ * With repeats the trace is replayed that many more times, printing
+ * nothing, and the mixer_update() time per frame of the fastest pass
+ * is reported on stderr. The fastest pass is the least disturbed by
+ * the rest of the host.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "system.h"
+#include "../sticks.c"
+#include "models.h"
+#include "host.h"
+
+#define REPLAY_MAX_FRAMES	4096
+
+typedef struct
+{
+	uint16_t dt;
+	uint16_t adc[STICK_SCAN_CHANNELS];
+	uint8_t switches;
+} ReplayFrame;
+
+static ReplayFrame frames[REPLAY_MAX_FRAMES];
+
+static int replay_load(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	char line[128];
+	int n = 0;
+
+	if (!fp)
+		return -1;
+
+	while (n < REPLAY_MAX_FRAMES && fgets(line, sizeof(line), fp)) {
+		ReplayFrame *f = &frames[n];
+		unsigned v[STICK_SCAN_CHANNELS + 2];
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%u %u %u %u %u %u %u %u", &v[0], &v[1], &v[2],
+				&v[3], &v[4], &v[5], &v[6], &v[7]) != STICK_SCAN_CHANNELS + 2)
+			continue;
+		f->dt = v[0];
+		for (int i = 0; i < STICK_SCAN_CHANNELS; ++i)
+			f->adc[i] = v[i + 1];
+		f->switches = v[STICK_SCAN_CHANNELS + 1];
+		n++;
+	}
+	fclose(fp);
+	return n;
+}
+
+static void replay_reset(const char *model)
+{
+	models_general();
+	models_load(model);
+	memset(stick_filter, 0, sizeof(stick_filter));
+	system_ticks = 0;
+	sticks_cal_compile();
+	mixer_init();
+}
+
+static uint64_t replay_frame(const ReplayFrame *f)
+{
+	uint64_t t;
+
+	system_ticks += f->dt;
+	host_switches = f->switches;
+	for (int i = 0; i < STICK_SCAN_CHANNELS; ++i)
+		adc_frame[i] = f->adc[i];
+
+	sticks_update();
+	sticks_filter();
+
+	t = host_ns();
+	mixer_update();
+	return host_ns() - t;
+}
+
+int main(int argc, char **argv)
+{
+	int n, repeats;
+	uint64_t best = UINT64_MAX;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s <model> <trace> [repeats]\n", argv[0]);
+		return 2;
+	}
+	n = replay_load(argv[2]);
+	if (n <= 0 || models_load(argv[1]) < 0) {
+		fprintf(stderr, "%s: can't load %s / %s\n", argv[0], argv[1], argv[2]);
+		return 2;
+	}
+	repeats = (argc > 3) ? atoi(argv[3]) : 0;
+
+	replay_reset(argv[1]);
+	printf("# %s %s\n", argv[1], argv[2]);
+	for (int i = 0; i < n; ++i) {
+		replay_frame(&frames[i]);
+		for (int c = 0; c < NUM_CHNOUT; ++c)
+			printf("%s%d", c ? " " : "", g_chans[c]);
+		printf("\n");
+	}
+
+	for (int r = 0; r < repeats; ++r) {
+		uint64_t ns = 0;
+
+		replay_reset(argv[1]);
+		for (int i = 0; i < n; ++i)
+			ns += replay_frame(&frames[i]);
+		if (ns < best)
+			best = ns;
+	}
+	if (repeats)
+		fprintf(stderr, "%s: %llu ns/frame mixer_update(), best of %d passes\n",
+				argv[1], (unsigned long long)(best / n), repeats);
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * SBUS frames built by pulses.c from channel frames, against reference
+ * frames written out byte for byte, and sbus_pack against a bit at a
+ * time packer for random values and flags.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_periph.h"
+#include "../pulses.c"
+#include "host.h"
+
+#define SBUS_CASES		200000
+
+static uint32_t seed = 7;
+
+static int rnd(int lo, int hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (int)((seed >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+// All channels centred, 992 = 0x3E0
+static const uint8_t sbus_centre[SBUS_FRAME_LEN] = {
+	0x0F, 0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C,
+	0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0x00,
+	0x00,
+};
+
+// CH1-CH16 from -RESX to +RESX, 192 299 406 512 619 725 832 939
+// 1045 1151 1258 1364 1471 1577 1684 1792
+static const uint8_t sbus_ramp[SBUS_FRAME_LEN] = {
+	0x0F, 0xC0, 0x58, 0x89, 0x65, 0x00, 0xB4, 0xA6, 0x6A, 0x01, 0x6D, 0x75,
+	0x15, 0xFC, 0xA3, 0x3A, 0xA9, 0xFA, 0xDB, 0x14, 0x53, 0x1A, 0xE0, 0x00,
+	0x00,
+};
+
+// The reference packing, one bit at a time
+static void sbus_ref(uint8_t *frame, const uint16_t *values, uint8_t flags)
+{
+	memset(frame, 0, SBUS_FRAME_LEN);
+	frame[0] = 0x0F;
+	for (int c = 0; c < 16; ++c)
+		for (int b = 0; b < 11; ++b)
+			if ((values[c] >> b) & 1)
+				frame[1 + (c * 11 + b) / 8] |= 1 << ((c * 11 + b) % 8);
+	frame[23] = flags;
+}
+
+static void sbus_check(int16_t *chans, const uint8_t *ref, uint8_t flags)
+{
+	static PulseTable pt;
+
+	pulses_build(&pt, PROTO_SBUS, (volatile int16_t*)chans);
+	HOST_CHECK(pt.serialLen == SBUS_FRAME_LEN);
+	HOST_CHECK(!pt.silent);
+	HOST_CHECK(memcmp(pt.serial, ref, SBUS_FRAME_LEN - 2) == 0);
+	HOST_CHECK(pt.serial[23] == flags);
+	HOST_CHECK(pt.serial[24] == 0x00);
+}
+
+int main(void)
+{
+	int16_t chans[NUM_CHNOUT];
+	uint16_t values[SBUS_CHANNELS];
+	uint8_t frame[SBUS_FRAME_LEN], ref[SBUS_FRAME_LEN];
+
+	g_model.extendedLimits = 0;
+	g_model.sbusFast = 0;
+
+	memset(chans, 0, sizeof(chans));
+	sbus_check(chans, sbus_centre, 0);
+
+	for (int i = 0; i < SBUS_CHANNELS; ++i)
+		chans[i] = -RESX + i * 2 * RESX / 15;
+	sbus_check(chans, sbus_ramp, 0);
+
+	// A no pulse channel goes out centred, flagged lost and failsafe
+	memset(chans, 0, sizeof(chans));
+	chans[3] = PULSES_NO_PULSE;
+	sbus_check(chans, sbus_centre, SBUS_FLAG_FRAME_LOST | SBUS_FLAG_FAILSAFE);
+
+	// Extended limits clamp to the ends of the 11 bits
+	g_model.extendedLimits = 1;
+	for (int i = 0; i < SBUS_CHANNELS; ++i)
+		chans[i] = (i & 1) ? 1500 : -1500;
+	for (int i = 0; i < SBUS_CHANNELS; ++i)
+		values[i] = (i & 1) ? SBUS_MAX : 0;
+	sbus_ref(ref, values, 0);
+	sbus_check(chans, ref, 0);
+
+	for (long c = 0; c < SBUS_CASES; ++c) {
+		uint8_t flags = rnd(0, 0x0F);
+
+		for (int i = 0; i < SBUS_CHANNELS; ++i)
+			values[i] = rnd(0, SBUS_MAX);
+		sbus_pack(frame, values, flags);
+		sbus_ref(ref, values, flags);
+		HOST_CHECK(memcmp(frame, ref, SBUS_FRAME_LEN) == 0);
+	}
+
+	printf("sbus: %d frames packed\n", SBUS_CASES);
+	return host_result("sbus");
+}
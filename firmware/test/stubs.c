@@ -0,0 +1,152 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Host stand-ins for the modules around the mixer, sticks and pulses
+ * code: the globals, keypad switches, sound, gui, tasks and perf.
+ * Switches come from host_switches. The pulses frame hand-over is in
+ * stubs_pulses.c, for the tests that don't link pulses.c.
+ *
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <time.h>
+
+#include "system.h"
+#include "myeeprom.h"
+#include "art6.h"
+#include "keypad.h"
+#include "sound.h"
+#include "gui.h"
+#include "tasks.h"
+#include "perf.h"
+#include "host.h"
+
+volatile uint32_t system_ticks;
+uint32_t SystemCoreClock = 24000000;
+
+volatile EEGeneral g_eeGeneral;
+volatile ModelData g_model;
+volatile uint8_t g_modelInvalid;
+
+uint8_t host_switches;
+
+static int host_failures;
+
+/**
+ * @brief  Report a failed HOST_CHECK().
+ * @param  file, line: Location of the check.
+ * @param  what: The expression that failed.
+ * @retval Always 1.
+ */
+int host_fail(const char *file, int line, const char *what)
+{
+	if (host_failures++ < 10)
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+	return 1;
+}
+
+/**
+ * @brief  Print the outcome of a test program.
+ * @param  name: Test name.
+ * @retval Exit status, 0 if no check failed.
+ */
+int host_result(const char *name)
+{
+	if (host_failures) {
+		printf("%s: %d checks failed\n", name, host_failures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+/**
+ * @brief  Monotonic time for the ns/frame figures.
+ * @retval Nanoseconds.
+ */
+uint64_t host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+uint8_t keypad_get_switches(void)
+{
+	return host_switches;
+}
+
+uint8_t keypad_get_switch(KEYPAD_SWITCH sw)
+{
+	return (sw == 0) || (host_switches & sw);
+}
+
+uint8_t keypad_get_switch_snapshot(KEYPAD_SWITCH sw)
+{
+	return (sw == 0) || (host_switches & sw);
+}
+
+void keypad_snapshot_switches(void)
+{
+}
+
+void keypad_cancel_repeat(void)
+{
+}
+
+void sound_play_tune(TUNE index)
+{
+}
+
+void sound_play_tone(uint16_t freq, uint16_t duration)
+{
+}
+
+void gui_update(UPDATE_TYPE type)
+{
+}
+
+void task_register(Tasks task, void (*fn)(uint32_t))
+{
+}
+
+void task_schedule(Tasks task, uint32_t data, uint32_t time_ms)
+{
+}
+
+void perf_record(PerfSlot slot, uint32_t start)
+{
+}
+
+void perf_trace(TracePoint point)
+{
+}
+
+void perf_trace_edge(uint32_t seq, uint32_t stamp)
+{
+}
+
+void perf_trace_publish(uint32_t seq)
+{
+}
+
+uint8_t perf_trace_get(uint32_t seq, TracePoint point, uint32_t *stamp)
+{
+	return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Host stand-in for the pulses side of the mixer: the trainer inputs
+ * and the double-buffered channel frame hand-over.
+ *
+ */
+
+#include "system.h"
+#include "myeeprom.h"
+#include "art6.h"
+#include "pulses.h"
+
+volatile int16_t g_ppmIns[8];
+volatile uint8_t ppmInValid;
+
+static volatile int16_t chan_frames[2][NUM_CHNOUT];
+volatile int16_t * volatile g_chans = chan_frames[0];
+
+volatile int16_t *pulses_frame_back(void)
+{
+	return (g_chans == chan_frames[0]) ? chan_frames[1] : chan_frames[0];
+}
+
+void pulses_frame_publish(volatile int16_t *frame)
+{
+	g_chans = frame;
+}
+
+void pulses_failsafe_changed(void)
+{
+}
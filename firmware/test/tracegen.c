@@ -0,0 +1,72 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * Writes the replay traces (traces/sweep.trc) to stdout.
+ * Integer only, so the trace is the same on every host.
+ *
+ * Each stick is a triangle sweep with its own period, running past the
+ * calibrated end points into the ADC limits, with a little noise. The
+ * switches count through all 16 states and the frame interval varies
+ * between 10 and 30 ms.
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TRACE_FRAMES	1200
+#define TRACE_CHANNELS	6
+
+static uint32_t seed = 12345;
+
+static int noise(int span)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (int)((seed >> 16) % (2 * span + 1)) - span;
+}
+
+static int triangle(int t, int period, int lo, int hi)
+{
+	int p = t % period;
+	int half = period / 2;
+
+	if (p < half)
+		return lo + (hi - lo) * p / half;
+	return hi - (hi - lo) * (p - half) / (period - half);
+}
+
+int main(void)
+{
+	static const int period[TRACE_CHANNELS] = { 97, 131, 211, 73, 307, 401 };
+
+	printf("# dt_ms adc0..adc5 switches\n");
+	for (int t = 0; t < TRACE_FRAMES; ++t) {
+		int dt = (t % 7 == 3) ? 10 : (t % 11 == 5) ? 30 : 20;
+
+		printf("%d", dt);
+		for (int i = 0; i < TRACE_CHANNELS; ++i) {
+			int v = triangle(t + 17 * i, period[i], 0, 4095) + noise(4);
+
+			// Park the sticks at the centre now and then
+			if ((t / 150) % 4 == 3)
+				v = 2050 + noise(2);
+			printf(" %d", v < 0 ? 0 : (v > 4095 ? 4095 : v));
+		}
+		printf(" %d\n", (t / 40) % 16);
+	}
+	return 0;
+}
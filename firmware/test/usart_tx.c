@@ -0,0 +1,116 @@
+/*
+ *                  Copyright 2014 ARTaylor.co.uk
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Author: Richard Taylor (richard@artaylor.co.uk)
+ */
+
+/* Description:
+ *
+ * usart_putc waiting on a full console queue. A timer signal stands in
+ * for the interrupts: it either drains the queue as the TXE interrupt
+ * would, or takes the port for a radio protocol as PendSV does. Either
+ * way usart_putc must return, and must not turn TXE back on once the
+ * port is taken.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L	// sigaction, setitimer
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "host_periph.h"
+#include "../usart.c"
+#include "host.h"
+
+#define TICK_US			1000
+#define TICK_LIMIT		2000	// Give up, usart_putc is stuck
+
+static volatile int ticks;
+static volatile int take_port;
+
+static void tick(int sig)
+{
+	if (++ticks > TICK_LIMIT) {
+		host_fail(__FILE__, __LINE__, "usart_putc returned");
+		exit(host_result("usart_tx"));
+	}
+	if (take_port) {
+		// What usart_set_serial does first
+		serial_mode = 1;
+		USART_ITConfig(USART1, USART_IT_RXNE | USART_IT_TXE | USART_IT_TC, DISABLE);
+		txrunning = 0;
+	} else {
+		host_usart1.SR |= USART_SR_TXE;
+		USART1_IRQHandler();
+	}
+}
+
+static void fill_queue(void)
+{
+	Queue_init(&txbuf);
+	while (Queue_put(&txbuf, 'x'))
+		;
+	USART_ITConfig(USART1, USART_IT_TXE, ENABLE);	// As the puts that filled it did
+}
+
+static void start_ticks(void)
+{
+	struct itimerval it = { { 0, TICK_US }, { 0, TICK_US } };
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = tick;
+	sigaction(SIGALRM, &sa, NULL);
+	ticks = 0;
+	setitimer(ITIMER_REAL, &it, NULL);
+}
+
+static void stop_ticks(void)
+{
+	struct itimerval it = { { 0, 0 }, { 0, 0 } };
+
+	setitimer(ITIMER_REAL, &it, NULL);
+}
+
+int main(void)
+{
+	// Console, the TXE interrupt drains the queue
+	serial_mode = 0;
+	fill_queue();
+	take_port = 0;
+	start_ticks();
+	usart_putc('a');
+	stop_ticks();
+	HOST_CHECK(host_usart1.CR1 & USART_CR1_TXEIE);
+
+	// The port is taken while waiting
+	fill_queue();
+	take_port = 1;
+	start_ticks();
+	usart_putc('b');
+	stop_ticks();
+	HOST_CHECK(serial_mode);
+	HOST_CHECK(!(host_usart1.CR1 & USART_CR1_TXEIE));
+
+	// Nothing goes to the console while the port is taken
+	Queue_init(&txbuf);
+	usart_putc('c');
+	usart_putc_nb('d');
+	HOST_CHECK(!(host_usart1.CR1 & USART_CR1_TXEIE));
+	HOST_CHECK(Queue_get(&txbuf) == 0);
+
+	return host_result("usart_tx");
+}
@@ -21,12 +21,19 @@
  * USART1_TX/TIM1_CH2/TIM15_BKIN/PA9
  * USART1_RX/TIM1_CH3/TIM17_BKIN/PA10
  *
+ * The radio output can take the port over for a serial protocol
+ * (usart_set_serial), frames then go out by DMA1 channel 4 and the
+ * console is muted until usart_set_console. Protocols with a return
+ * path run half-duplex on the TX pin, the receiver is off while a frame
+ * goes out so it does not hear it.
+ *
  */
 
 #include "stm32f10x.h"
 #include "system.h"
 #include "usart.h"
 #include "stm32f10x_usart.h"
+#include "perf.h"
 
 #define USE_QUEUE
 
@@ -122,6 +129,8 @@ uint8_t Queue_peek(Queue* pCB, uint8_t b) {
 ///////////////////////////////////////////////////////////////////////////////
 
 static volatile uint8_t txrunning = 0;
+static volatile uint8_t serial_mode = 0;	// Port taken by a radio protocol
+static void (*serial_rx_handler)(uint8_t data) = 0;	// Its half-duplex receiver
 static Queue txbuf;
 static Queue rxbuf;
 static void (*registered_rx_handler)(uint8_t data) = 0;
@@ -140,15 +149,32 @@ void usart_register_rx_handler(void (*rx_handler)(uint8_t data)) {
 }
 
 
+#ifdef USE_QUEUE
+/**
+ * @brief  Start the TXE interrupt draining the console queue
+ * @note   A protocol may take the port (from PendSV) between the caller's
+ *         serial_mode check and here, so check again with interrupts off.
+ * @retval None
+ */
+static void usart_tx_kick(void) {
+	__disable_irq();
+	if (!serial_mode)
+		USART_ITConfig(USART1, USART_IT_TXE, ENABLE);
+	__enable_irq();
+}
+#endif
+
 /**
  * @brief  print char on uart1 non-blocking
  * @param  c char
  * @retval None
  */
 void usart_putc_nb(char c) {
+	if (serial_mode)
+		return;
 #ifdef USE_QUEUE
 	Queue_put(&txbuf, c);
-	USART_ITConfig(USART1, USART_IT_TXE, ENABLE);
+	usart_tx_kick();
 #else
 	USART_SendData(USART1, c);
 #endif
@@ -160,10 +186,15 @@ void usart_putc_nb(char c) {
  * @retval None
  */
 void usart_putc(char c) {
+	if (serial_mode)
+		return;
 #ifdef USE_QUEUE
-	while( Queue_put(&txbuf, c) == 0 )
-		;
-	USART_ITConfig(USART1, USART_IT_TXE, ENABLE);
+	while( Queue_put(&txbuf, c) == 0 ) {
+		// The queue only drains while the console owns the port
+		if (serial_mode)
+			return;
+	}
+	usart_tx_kick();
 #else
 	USART_SendData(USART1, c);
 	while (USART_GetFlagStatus(USART1, USART_FLAG_TXE) == RESET)
@@ -266,17 +297,147 @@ void usart_init() {
 	usart_puts("FS-T6\r\n");
 }
 
+/**
+ * @brief  Hand the port to a radio protocol
+ * @note   Frames are sent with usart_dma_send. With an rx_handler the
+ *         port is half-duplex on the TX pin and gets the replies.
+ * @param  baud baudrate
+ * @param  parity USART_Parity_x, the word length follows it
+ * @param  stopBits USART_StopBits_x
+ * @param  rx_handler function to call with each byte received, or 0
+ * @retval None
+ */
+void usart_set_serial(uint32_t baud, uint16_t parity, uint16_t stopBits,
+		void (*rx_handler)(uint8_t data)) {
+	serial_mode = 1;
+	USART_ITConfig(USART1, USART_IT_RXNE | USART_IT_TXE | USART_IT_TC, DISABLE);
+	USART_Cmd(USART1, DISABLE);
+	txrunning = 0;
+	serial_rx_handler = rx_handler;
+
+	/* Half-duplex releases TX when idle, the module pulls it up */
+	GPIO_InitTypeDef GPIO_InitStructure;
+	GPIO_InitStructure.GPIO_Mode = rx_handler ? GPIO_Mode_AF_OD : GPIO_Mode_AF_PP;
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_9;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOA, &GPIO_InitStructure);
+
+	USART_InitTypeDef USART_InitStructure;
+	USART_InitStructure.USART_BaudRate = baud;
+	USART_InitStructure.USART_WordLength = (parity == USART_Parity_No) ?
+			USART_WordLength_8b : USART_WordLength_9b;
+	USART_InitStructure.USART_StopBits = stopBits;
+	USART_InitStructure.USART_Parity = parity;
+	USART_InitStructure.USART_HardwareFlowControl =
+			USART_HardwareFlowControl_None;
+	USART_InitStructure.USART_Mode = rx_handler ?
+			USART_Mode_Rx | USART_Mode_Tx : USART_Mode_Tx;
+	USART_Init(USART1, &USART_InitStructure);
+	USART_HalfDuplexCmd(USART1, rx_handler ? ENABLE : DISABLE);
+
+	/* DMA1 channel 4 (USART1_TX), memory to TDR */
+	DMA_InitTypeDef dmaInit;
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+	DMA_DeInit(DMA1_Channel4);
+	DMA_StructInit(&dmaInit);
+	dmaInit.DMA_PeripheralBaseAddr = (uint32_t) &USART1->DR;
+	dmaInit.DMA_DIR = DMA_DIR_PeripheralDST;
+	dmaInit.DMA_BufferSize = 1;
+	dmaInit.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dmaInit.DMA_Priority = DMA_Priority_Medium;
+	DMA_Init(DMA1_Channel4, &dmaInit);
+	USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
+
+	USART_Cmd(USART1, ENABLE);
+	if (rx_handler)
+		USART_ITConfig(USART1, USART_IT_RXNE, ENABLE);
+}
+
+/**
+ * @brief  Give the port back to the console
+ * @note   Does nothing unless usart_set_serial took it
+ * @param  None
+ * @retval None
+ */
+void usart_set_console() {
+	if (!serial_mode)
+		return;
+
+	USART_ITConfig(USART1, USART_IT_RXNE | USART_IT_TC, DISABLE);
+	USART_Cmd(USART1, DISABLE);
+	USART_DMACmd(USART1, USART_DMAReq_Tx, DISABLE);
+	USART_HalfDuplexCmd(USART1, DISABLE);
+	DMA_Cmd(DMA1_Channel4, DISABLE);
+	serial_rx_handler = 0;
+
+	GPIO_InitTypeDef GPIO_InitStructure;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_9;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOA, &GPIO_InitStructure);
+
+	USART_InitTypeDef USART_InitStructure;
+	USART_InitStructure.USART_BaudRate = 115200;
+	USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+	USART_InitStructure.USART_StopBits = USART_StopBits_1;
+	USART_InitStructure.USART_Parity = USART_Parity_No;
+	USART_InitStructure.USART_HardwareFlowControl =
+			USART_HardwareFlowControl_None;
+	USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+	USART_Init(USART1, &USART_InitStructure);
+
+	Queue_init(&txbuf);
+	Queue_init(&rxbuf);
+	serial_mode = 0;
+
+	USART_Cmd(USART1, ENABLE);
+	USART_ITConfig(USART1, USART_IT_RXNE, ENABLE);
+}
+
+/**
+ * @brief  Send a protocol frame by DMA
+ * @note   Any frame still going out is cut short, the buffer must stay
+ *         untouched until sent. Half-duplex turns the receiver back on
+ *         from the transmission complete interrupt.
+ * @param  buf frame
+ * @param  len frame length
+ * @retval None
+ */
+void usart_dma_send(const uint8_t *buf, uint8_t len) {
+	if (serial_rx_handler) {
+		USART1->CR1 &= (uint16_t)~USART_CR1_RE;
+		USART_ClearFlag(USART1, USART_FLAG_TC);
+		USART_ITConfig(USART1, USART_IT_TC, ENABLE);
+	}
+	DMA1_Channel4->CCR &= (uint16_t)~DMA_CCR1_EN;
+	DMA1_Channel4->CMAR = (uint32_t) buf;
+	DMA1_Channel4->CNDTR = len;
+	DMA1_Channel4->CCR |= DMA_CCR1_EN;
+}
+
 /**
  * @brief  USART1's interrupt handler
  * @param  None
  * @retval None
  */
 void USART1_IRQHandler() {
+	uint32_t perf = perf_start();
+
+	if (USART_GetITStatus(USART1, USART_IT_TC)) {
+		// Half-duplex frame sent, listen for the reply
+		USART_ITConfig(USART1, USART_IT_TC, DISABLE);
+		USART1->CR1 |= USART_CR1_RE;
+	}
 	if (USART_GetITStatus(USART1, USART_IT_RXNE)) {
 		uint8_t data = USART_ReceiveData(USART1);
 		USART_ClearITPendingBit(USART1, USART_IT_RXNE); // Clear interrupt flag
-		Queue_put(&rxbuf, data);
-		if( registered_rx_handler ) registered_rx_handler(data);
+		if (serial_mode) {
+			if (serial_rx_handler)
+				serial_rx_handler(data);
+		} else {
+			Queue_put(&rxbuf, data);
+			if( registered_rx_handler ) registered_rx_handler(data);
+		}
 	}
 	if (USART_GetITStatus(USART1, USART_IT_TXE)) {
 		USART_ClearITPendingBit(USART1, USART_IT_TXE); // Clear interrupt flag
@@ -288,4 +449,6 @@ void USART1_IRQHandler() {
 			txrunning = 0;
 		}
 	}
+
+	perf_record(PERF_USART1, perf);
 }
@@ -25,6 +25,11 @@ void usart_puts(const char* s);
 //void usart_put(const char* s, uint8_t len);
 void usart_putc_nb(char c);
 
+void usart_set_serial(uint32_t baud, uint16_t parity, uint16_t stopBits,
+		void (*rx_handler)(uint8_t data));
+void usart_set_console();
+void usart_dma_send(const uint8_t *buf, uint8_t len);
+
 uint16_t usart_getc();
 uint8_t usart_peekc(uint8_t c);
 